@@ -75,7 +75,7 @@ bool build_miniaudio_lib(bool debug_build, bool x64_build, bool release_build)
     nob_cmd_append(&cmd, "gcc");
     if (x64_build)
         nob_cmd_append(&cmd, "-m64");
-    nob_cmd_append(&cmd, "-Wall", "-Wextra", "-std=c99");
+    nob_cmd_append(&cmd, "-Wall", "-Wextra", "-std=c11");
 
     if (debug_build)
     {
@@ -100,7 +100,7 @@ bool build_miniaudio_lib(bool debug_build, bool x64_build, bool release_build)
 }
 
 // Function to build UI application
-bool build_ui(bool debug_build, bool x64_build, bool release_build)
+bool build_ui(bool debug_build, bool x64_build, bool release_build, bool float32_build)
 {
     // Check if UI main file exists
     const char *ui_main_file = UI_FOLDER "Qsynth.c";
@@ -123,7 +123,14 @@ bool build_ui(bool debug_build, bool x64_build, bool release_build)
     }
 
     // Warning flags
-    nob_cmd_append(&cmd, "-Wall", "-Wextra", "-std=c99");
+    nob_cmd_append(&cmd, "-Wall", "-Wextra", "-std=c11");
+
+    // the AVX kernels spill wide vectors to the stack, mingw cannot realign it for them, keep the moves unaligned
+    nob_cmd_append(&cmd, "-Wa,-muse-unaligned-vector-move");
+
+    // single precision audio path, see src/utils/sample.h
+    if (float32_build)
+        nob_cmd_append(&cmd, "-DQSYNTH_FLOAT32=1");
 
     // Build type flags
     if (debug_build)
@@ -147,9 +154,15 @@ bool build_ui(bool debug_build, bool x64_build, bool release_build)
     nob_cmd_append(&cmd, SRC_FOLDER "assets/instruments.c");
     nob_cmd_append(&cmd, SRC_FOLDER "core/core.c");
     nob_cmd_append(&cmd, SRC_FOLDER "core/voice.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "core/voice_bank.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "core/dsp_kernels.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "core/dsp_pool.c");
     nob_cmd_append(&cmd, SRC_FOLDER "envelope/adsr.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "modulation/modulation.c");
     nob_cmd_append(&cmd, SRC_FOLDER "filters/biquad.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "filters/svf.c");
     nob_cmd_append(&cmd, SRC_FOLDER "oscillators/oscillators.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "oscillators/wavetable.c");
     nob_cmd_append(&cmd, SRC_FOLDER "utils/note_table.c");
     nob_cmd_append(&cmd, SRC_FOLDER "pedals/reverb.c");
     nob_cmd_append(&cmd, SRC_FOLDER "pedals/distortion.c");
@@ -198,7 +211,7 @@ bool build_ui(bool debug_build, bool x64_build, bool release_build)
 }
 
 // Function to build tests application
-bool build_tests(const char *tests_name, bool debug_build, bool x64_build, bool release_build)
+bool build_tests(const char *tests_name, bool debug_build, bool x64_build, bool release_build, bool float32_build)
 {
     // Check if tests file exists
     Nob_String_Builder tests_path = {0};
@@ -226,7 +239,14 @@ bool build_tests(const char *tests_name, bool debug_build, bool x64_build, bool
         nob_cmd_append(&cmd, "-m64");
     }
     // Warning flags
-    nob_cmd_append(&cmd, "-Wall", "-Wextra", "-std=c99");
+    nob_cmd_append(&cmd, "-Wall", "-Wextra", "-std=c11");
+
+    // the AVX kernels spill wide vectors to the stack, mingw cannot realign it for them, keep the moves unaligned
+    nob_cmd_append(&cmd, "-Wa,-muse-unaligned-vector-move");
+
+    // single precision audio path, see src/utils/sample.h
+    if (float32_build)
+        nob_cmd_append(&cmd, "-DQSYNTH_FLOAT32=1");
 
     // Build type flags
     if (debug_build)
@@ -249,9 +269,15 @@ bool build_tests(const char *tests_name, bool debug_build, bool x64_build, bool
     nob_cmd_append(&cmd, SRC_FOLDER "assets/instruments.c");
     nob_cmd_append(&cmd, SRC_FOLDER "core/core.c");
     nob_cmd_append(&cmd, SRC_FOLDER "core/voice.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "core/voice_bank.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "core/dsp_kernels.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "core/dsp_pool.c");
     nob_cmd_append(&cmd, SRC_FOLDER "envelope/adsr.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "modulation/modulation.c");
     nob_cmd_append(&cmd, SRC_FOLDER "filters/biquad.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "filters/svf.c");
     nob_cmd_append(&cmd, SRC_FOLDER "oscillators/oscillators.c");
+    nob_cmd_append(&cmd, SRC_FOLDER "oscillators/wavetable.c");
     nob_cmd_append(&cmd, SRC_FOLDER "utils/note_table.c");
     nob_cmd_append(&cmd, SRC_FOLDER "pedals/reverb.c");
     nob_cmd_append(&cmd, SRC_FOLDER "pedals/distortion.c");
@@ -298,11 +324,15 @@ void print_usage(const char *program_name)
     nob_log(NOB_INFO, "  %s instruments_test", program_name);
     nob_log(NOB_INFO, "  %s basic_synth", program_name);
     nob_log(NOB_INFO, "  %s sine_wave_test", program_name);
+    nob_log(NOB_INFO, "  %s offline_render", program_name);
+    nob_log(NOB_INFO, "  %s fastmath_test", program_name);
+    nob_log(NOB_INFO, "  %s biquad_test", program_name);
     nob_log(NOB_INFO, "");
     nob_log(NOB_INFO, "Options:");
     nob_log(NOB_INFO, "  --debug     Build with debug symbols");
     nob_log(NOB_INFO, "  --x64       Build for 64-bit");
     nob_log(NOB_INFO, "  --release   Build with optimizations (default)");
+    nob_log(NOB_INFO, "  --float32   Run the audio path in single precision");
 }
 
 int main(int argc, char **argv)
@@ -320,6 +350,7 @@ int main(int argc, char **argv)
     bool debug_build = false;
     bool x64_build = false;
     bool release_build = true;
+    bool float32_build = false;
 
     // Parse options
     for (int i = 2; i < argc; i++)
@@ -338,6 +369,10 @@ int main(int argc, char **argv)
             release_build = true;
             debug_build = false;
         }
+        else if (strcmp(argv[i], "--float32") == 0)
+        {
+            float32_build = true;
+        }
         else
         {
             nob_log(NOB_ERROR, "Unknown option: %s", argv[i]);
@@ -373,7 +408,7 @@ int main(int argc, char **argv)
     // Check if target is UI
     if (strcmp(target, "ui") == 0)
     {
-        build_success = build_ui(debug_build, x64_build, release_build);
+        build_success = build_ui(debug_build, x64_build, release_build, float32_build);
 
         if (build_success)
         {
@@ -385,7 +420,7 @@ int main(int argc, char **argv)
     else
     {
         // Build tests
-        build_success = build_tests(target, debug_build, x64_build, release_build);
+        build_success = build_tests(target, debug_build, x64_build, release_build, float32_build);
 
         if (build_success)
         {
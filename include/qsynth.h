@@ -15,7 +15,8 @@ typedef struct Synthesizer Synthesizer;
 #define VOICE_BUFFER_SIZE 8192
 #define VOICE_BUFFER_REFILL_THRESHOLD 0.5
 #define VOICE_REFILL_CHUNK_SIZE 8192
-#define MAX_VOICE_ACTIVE 12
+#define MAX_VOICE_ACTIVE 12 // default polyphony, see QSynthCfg.voice_n
+#define MAX_VOICE_LIMIT 256
 
 #define VOICE_MIX_BUFFER_SIZE 1024
 #define VOICE_MIX_BUFFER_REFILL_THRESHOLD 0.5
@@ -24,18 +25,55 @@ typedef struct Synthesizer Synthesizer;
 #define PEDALCHAIN_BUFFER_SIZE 1024
 #define PEDALCHAIN_BUFFER_REFILL_THRESHOLD 0.5
 #define PEDALCHAIN_REFILL_CHUNK_SIZE 1024
+#define PEDALCHAIN_MAX_PEDALS 32
+
+#define COMMAND_QUEUE_SIZE 1024 // control calls buffered until the next render block, power of 2
+#define EVENT_QUEUE_SIZE 4096   // scheduled events waiting for their frame time
+
+#define QSYNTH_NOISE_SEED 0x2545f491u // default QSynthCfg.noise_seed
+
+#define RENDER_BLOCK_SIZE 256 // max frames rendered per engine pass in pull mode
 
 // #define REFILL_CHUNK_SIZE 8192
 
+typedef enum
+{
+    QSYNTH_RENDER_PULL,    // audio callback renders voices, mix and pedals per block
+    QSYNTH_RENDER_THREADED // legacy voice/mix/pedal worker threads feeding ring buffers
+} QSynthRenderMode;
+
+typedef enum
+{
+    QSYNTH_STEAL_RELEASED_FIRST, // oldest voice already releasing, otherwise the oldest voice
+    QSYNTH_STEAL_OLDEST,
+    QSYNTH_STEAL_QUIETEST, // lowest envelope level x amplitude
+    QSYNTH_STEAL_NONE      // drop new notes while every voice is busy
+} QSynthStealPolicy;
+
+typedef struct
+{
+    double sample_rate;
+    int channels;
+    QSynthRenderMode render_mode;
+    int voice_n;                    // polyphony, preallocated at init, 0 = MAX_VOICE_ACTIVE
+    QSynthStealPolicy steal_policy; // what a note does when every voice is busy (pull mode only)
+    int worker_n; // DSP workers rendering voices in pull mode (including the audio thread), 0 = core count
+    bool headless; // open no audio device, audio is pulled with synth_render (pull mode only)
+    uint32_t noise_seed; // keys the noise of every note, same seed and same notes render the same noise
+} QSynthCfg;
+
 typedef enum
 {
     NOTE_CONTROL_DURATION, // Use duration_ms
     NOTE_CONTROL_MANUAL    // Use start_note/end_note API
 } NoteControlMode;
 
+#define MIDI_CHANNELS 16
+
 typedef struct
 {
     int midi_note;
+    int channel; // 0-15, key for synth_end_note_by_key
     int duration_ms;
     double amplitude;
     double pan;
@@ -53,6 +91,7 @@ typedef enum
     QSYNTH_ERROR_CONFIG,
     QSYNTH_ERROR_WORKER,
     QSYNTH_ERROR_UNSUPPORT,
+    QSYNTH_ERROR_QUEUE_FULL,
 } QSynthError;
 
 // should be consistent with ma_device_state
@@ -80,15 +119,32 @@ typedef struct
 
 // qsynth init/deinit
 bool synth_init(Synthesizer **synth_ptr, double sample_rate, int channels);
+bool synth_init_cfg(Synthesizer **synth_ptr, const QSynthCfg *cfg);
+bool synth_init_offline(Synthesizer **synth_ptr, double sample_rate, int channels);
+QSynthCfg synth_default_cfg(double sample_rate, int channels);
 void synth_cleanup(Synthesizer *synth);
 
 // qsynth streaming
 bool synth_start(Synthesizer *synth);
 void synth_stop(Synthesizer *synth);
 
+// qsynth offline rendering (headless synth only), faster than realtime
+bool synth_render(Synthesizer *synth, float *interleaved_out, uint32_t frames);
+
 // qsynth basic sound interface
+// control calls are queued and applied at the start of the next render block, they are safe from any thread
+// synth_play_note returns a note handle for synth_end_note, -1 on failure
+// handles are never reused, ending a note that already finished never touches the voice that took over
 int synth_play_note(Synthesizer *synth, InstrumentType instrument, NoteControlMode control_mode, NoteCfg *cfg);
-void synth_end_note(Synthesizer *synth, int voice_id);
+void synth_end_note(Synthesizer *synth, int note_id);
+void synth_end_note_by_key(Synthesizer *synth, int channel, int midi_note);
+
+// qsynth sample accurate sequencing, frame_time counts frames rendered since init (see synth_get_frame_time)
+// events land on their exact sample inside a render block, times in the past play at the next block
+// at most EVENT_QUEUE_SIZE events wait at once, beyond that the calls fail with QSYNTH_ERROR_QUEUE_FULL
+int synth_schedule_note(Synthesizer *synth, uint64_t frame_time, InstrumentType instrument, NoteControlMode control_mode, NoteCfg *cfg);
+bool synth_schedule_note_off(Synthesizer *synth, uint64_t frame_time, int note_id);
+uint64_t synth_get_frame_time(Synthesizer *synth);
 
 // qsynth global setting
 double synth_set_master_volume(Synthesizer *synth, double volume);
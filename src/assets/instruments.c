@@ -9,10 +9,10 @@ static const InstrumentSignature instrument_signatures[INST_COUNT] = {
     [INST_LEAD_SQUARE] = {
         .tone = {
             .layers = {
-                {.type = WAVE_SQUARE},
-                {.type = WAVE_SAWTOOTH},
-                {.type = WAVE_SQUARE},
-                {.type = WAVE_TRIANGLE},
+                {.type = WAVE_SQUARE, .osc = WAVE_OSC_POLYBLEP},
+                {.type = WAVE_SAWTOOTH, .osc = WAVE_OSC_POLYBLEP},
+                {.type = WAVE_SQUARE, .osc = WAVE_OSC_POLYBLEP},
+                {.type = WAVE_TRIANGLE, .osc = WAVE_OSC_POLYBLEP},
             },
             .detune = {0.0, 0.03, -12.0, 12.0},
             .mix_levels = {0.5, 0.3, 0.15, 0.05},
@@ -62,9 +62,9 @@ static const InstrumentSignature instrument_signatures[INST_COUNT] = {
     // 3. METALLIC PLUCK
     [INST_METALLIC_PLUCK] = {.tone = {
                                  .layers = {
-                                     {.type = WAVE_SAWTOOTH},
-                                     {.type = WAVE_SQUARE},
-                                     {.type = WAVE_TRIANGLE},
+                                     {.type = WAVE_SAWTOOTH, .osc = WAVE_OSC_POLYBLEP},
+                                     {.type = WAVE_SQUARE, .osc = WAVE_OSC_POLYBLEP},
+                                     {.type = WAVE_TRIANGLE, .osc = WAVE_OSC_POLYBLEP},
                                  },
                                  .detune = {0.0, 0.03, -0.03},
                                  .mix_levels = {0.5, 0.3, 0.2},
@@ -85,8 +85,11 @@ static const InstrumentSignature instrument_signatures[INST_COUNT] = {
                               .detune = {0.0, 0.07},
                               .mix_levels = {0.7, 0.3},
                               .phase_diff = {0, 180},
-                              .filter_opt = {.cutoff = 400, .filter_type = FILTER_LOWPASS, .resonance = 0.9},
+                              .filter_opt = {.cutoff = 400, .filter_type = FILTER_LOWPASS, .resonance = 0.9, .topology = FILTER_TOPOLOGY_SVF},
                               .envelope_opt = ENVELOPE_OPT_BASS,
+                              // 4 Hz wobble, +-2 octaves around the cutoff, starts closed
+                              .mod = {.lfo = {{.shape = MOD_LFO_SINE, .rate = 4.0, .phase = 270}},
+                                      .routes = {{.source = MOD_SRC_LFO1, .target = MOD_DST_CUTOFF, .depth = 2.0}}},
                           },
                           .name = "Wobble Bass",
                           .category = "Bass",
@@ -351,6 +354,12 @@ void instrument_print_details(InstrumentType type)
             case WAVE_NOISE:
                 wave_name = "Noise Wave";
                 break;
+            case WAVE_PINK_NOISE:
+                wave_name = "Pink Noise";
+                break;
+            case WAVE_BROWN_NOISE:
+                wave_name = "Brown Noise";
+                break;
             case WAVE_SQUARE:
                 wave_name = "Square Wave";
                 break;
@@ -394,6 +403,7 @@ void instrument_print_details(InstrumentType type)
         printf("  Type: %s\n", filter_name);
         printf("  Cutoff: %.0f Hz\n", inst->tone.filter_opt.cutoff);
         printf("  Resonance: %.2f\n", inst->tone.filter_opt.resonance);
+        printf("  Slope: %d dB/oct\n", 12 * biquad_stages(&inst->tone.filter_opt));
     }
     else
     {
@@ -180,6 +180,8 @@ bool pedal_chain_destroy(PedalChain *pedal_chain, bool is_destory_pedals)
     if (!pedal_chain)
         return false;
 
+    stream_destroy(&pedal_chain->streamer);
+
     PedalNode *current = pedal_chain->head;
     while (current)
     {
@@ -201,38 +203,28 @@ int pedal_chain_append(PedalChain *pedal_chain, Pedal *pedal)
     if (!pedal_chain || !pedal)
         return -1;
 
-    PedalNode *new_node = malloc(sizeof(PedalNode));
-    if (!new_node)
+    int idx = (int)pedal_chain->pedal_n;
+    if (!pedal_chain_insert(pedal_chain, idx, pedal))
         return -1;
 
-    new_node->pedal = pedal;
-    new_node->next = NULL;
+    return idx;
+}
 
-    // if chain is empty, make this the head
-    if (!pedal_chain->head)
-    {
-        pedal_chain->head = new_node;
-    }
-    else
-    {
-        // find the last node and append
-        PedalNode *current = pedal_chain->head;
-        while (current->next)
-        {
-            current = current->next;
-        }
-        current->next = new_node;
-    }
+bool pedal_chain_remove(PedalChain *pedal_chain, int idx)
+{
+    PedalNode *to_remove = pedal_chain_unlink(pedal_chain, idx);
+    if (!to_remove)
+        return false;
 
-    pedal_chain->pedal_n++;
-    return pedal_chain->pedal_n - 1;
+    free(to_remove);
+    return true;
 }
 
-bool pedal_chain_remove(PedalChain *pedal_chain, int idx)
+PedalNode *pedal_chain_unlink(PedalChain *pedal_chain, int idx)
 {
     if (!pedal_chain || idx < 0 || idx >= (int)pedal_chain->pedal_n)
     {
-        return false;
+        return NULL;
     }
 
     // removing head if idx=0
@@ -240,9 +232,8 @@ bool pedal_chain_remove(PedalChain *pedal_chain, int idx)
     {
         PedalNode *to_remove = pedal_chain->head;
         pedal_chain->head = pedal_chain->head->next;
-        free(to_remove);
         pedal_chain->pedal_n--;
-        return true;
+        return to_remove;
     }
 
     PedalNode *current = pedal_chain->head;
@@ -253,10 +244,9 @@ bool pedal_chain_remove(PedalChain *pedal_chain, int idx)
 
     PedalNode *to_remove = current->next;
     current->next = to_remove->next;
-    free(to_remove);
     pedal_chain->pedal_n--;
 
-    return true;
+    return to_remove;
 }
 
 bool pedal_chain_swap(PedalChain *pedal_chain, int idx1, int idx2)
@@ -286,8 +276,6 @@ bool pedal_chain_insert(PedalChain *pedal_chain, int idx, Pedal *pedal)
 {
     if (!pedal_chain || !pedal)
         return false;
-    if (idx < 0 || idx > (int)pedal_chain->pedal_n)
-        return false;
 
     PedalNode *new_node = malloc(sizeof(PedalNode));
     if (!new_node)
@@ -295,6 +283,21 @@ bool pedal_chain_insert(PedalChain *pedal_chain, int idx, Pedal *pedal)
 
     new_node->pedal = pedal;
 
+    if (!pedal_chain_insert_node(pedal_chain, idx, new_node))
+    {
+        free(new_node);
+        return false;
+    }
+    return true;
+}
+
+bool pedal_chain_insert_node(PedalChain *pedal_chain, int idx, PedalNode *new_node)
+{
+    if (!pedal_chain || !new_node)
+        return false;
+    if (idx < 0 || idx > (int)pedal_chain->pedal_n)
+        return false;
+
     // insert at beginning
     if (idx == 0)
     {
@@ -334,7 +337,7 @@ PedalNode *pedal_chain_get(PedalChain *pedal_chain, int idx)
     return current;
 }
 
-void pedal_chain_process_stereo(PedalChain *pedal_chain, double *left, double *right)
+void pedal_chain_process_stereo(PedalChain *pedal_chain, qsample *left, qsample *right)
 {
     if (!pedal_chain || !left || !right)
         return;
@@ -10,7 +10,7 @@ typedef struct
 {
     bool (*pedal_create)(void **instance_ptr, double sample_rate);
     void (*pedal_destroy)(void *instance);
-    double (*pedal_process)(void *instance, double sample);
+    qsample (*pedal_process)(void *instance, qsample sample);
     void (*pedal_set_params)(void *instance, double params[PEDAL_MAX_PARAMS]);
 } PedalVTable;
 
@@ -32,7 +32,7 @@ typedef struct
     PedalVTable vtable;
 } Pedal;
 
-static inline void pedal_process(Pedal *pedal, double *left, double *right)
+static inline void pedal_process(Pedal *pedal, qsample *left, qsample *right)
 {
     if (!pedal || !pedal->pedal_instance_left || !pedal->pedal_instance_right || !left || !right || pedal->bypass)
         return;
@@ -59,7 +59,7 @@ typedef struct
     size_t pedal_n;
 
     // streaming state
-    double stream_buf[PEDALCHAIN_BUFFER_SIZE];
+    qsample stream_buf[PEDALCHAIN_BUFFER_SIZE];
     AudioStreamBuffer streamer;
 } PedalChain; // basically a single direction linklist
 
@@ -71,9 +71,13 @@ bool pedal_chain_swap(PedalChain *pedal_chain, int idx1, int idx2);
 bool pedal_chain_insert(PedalChain *pedal_chain, int idx, Pedal *pedal);
 PedalNode *pedal_chain_get(PedalChain *pedal_chain, int idx);
 
+// node level variants, no allocation so they are safe on the render thread
+bool pedal_chain_insert_node(PedalChain *pedal_chain, int idx, PedalNode *node);
+PedalNode *pedal_chain_unlink(PedalChain *pedal_chain, int idx);
+
 void pedal_chain_print(PedalChain *pedal_chain);
 
-static inline void pedal_chain_process(PedalChain *pedal_chain, double *left, double *right)
+static inline void pedal_chain_process(PedalChain *pedal_chain, qsample *left, qsample *right)
 {
     if (!pedal_chain || !left || !right)
         return;
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "qsynth.h"
+#include "tone.h"
+#include "stream.h"
+#include "../assets/pedal_core.h"
+
+typedef enum
+{
+    SYNTH_CMD_NOTE_ON,
+    SYNTH_CMD_NOTE_OFF,
+    SYNTH_CMD_NOTE_OFF_KEY,
+    SYNTH_CMD_MASTER_VOLUME,
+    SYNTH_CMD_PEDAL_INSERT,
+    SYNTH_CMD_PEDAL_REMOVE,
+    SYNTH_CMD_PEDAL_SWAP,
+    SYNTH_CMD_PEDAL_SET_PARAM,
+    SYNTH_CMD_PEDAL_SET_BYPASS,
+    SYNTH_CMD_PEDAL_RETIRE, // render -> control, node unlinked from the chain, free it
+} SynthCommandType;
+
+// one control call, everything the render side needs is resolved by the caller
+typedef struct
+{
+    SynthCommandType type;
+    uint64_t frame_time; // render frame to apply the command at, earlier frames apply at the next block
+    union
+    {
+        struct
+        {
+            int note_id;
+            const Tone *tone;
+            double frequency;
+            NoteControlMode control_mode;
+            NoteCfg cfg;
+        } note_on;
+
+        struct
+        {
+            int note_id;
+            int channel; // by key only
+            int midi_note;
+        } note_off;
+
+        struct
+        {
+            double volume;
+        } master_volume;
+
+        struct
+        {
+            int idx;
+            int idx2;        // swap only
+            PedalNode *node; // insert/retire, allocated and freed by the control side
+            int param_idx;
+            double value;
+            bool bypass;
+        } pedal;
+    };
+} SynthCommand;
+
+typedef struct
+{
+    _Atomic uint32_t seq; // turn counter, tells producers and the consumer whose turn the cell is
+    SynthCommand cmd;
+} CommandCell;
+
+// Bounded lock-free MPMC queue (Vyukov), used as MPSC: any control thread pushes, the render thread pops
+// Producers claim a cell with one CAS on the enqueue position and never wait for each other or the consumer,
+// a full queue fails the push instead of blocking
+typedef struct
+{
+    _Atomic uint32_t enqueue_pos;
+    char _pad_enqueue[STREAM_CACHE_LINE - sizeof(uint32_t)];
+
+    _Atomic uint32_t dequeue_pos;
+    char _pad_dequeue[STREAM_CACHE_LINE - sizeof(uint32_t)];
+
+    CommandCell cells[COMMAND_QUEUE_SIZE];
+} CommandQueue;
+
+static inline void command_queue_init(CommandQueue *queue)
+{
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    for (uint32_t i = 0; i < COMMAND_QUEUE_SIZE; i++)
+        atomic_init(&queue->cells[i].seq, i);
+}
+
+/**
+ * Push a command (any thread)
+ * @param queue Queue to push to
+ * @param cmd Command to copy into the queue
+ * @return false if the queue is full
+ */
+static inline bool command_queue_push(CommandQueue *queue, const SynthCommand *cmd)
+{
+    uint32_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    CommandCell *cell;
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & (COMMAND_QUEUE_SIZE - 1)];
+        uint32_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (diff == 0)
+        {
+            // cell is free for this position, claim it
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // consumer has not freed the cell one lap ago
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->cmd = *cmd;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Check that the next push finds a free cell, only holds until the push with a single producer
+ * @param queue Queue to check
+ * @return false if the queue is full
+ */
+static inline bool command_queue_has_room(CommandQueue *queue)
+{
+    uint32_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    CommandCell *cell = &queue->cells[pos & (COMMAND_QUEUE_SIZE - 1)];
+    return atomic_load_explicit(&cell->seq, memory_order_acquire) == pos;
+}
+
+/**
+ * Pop the oldest command
+ * @param queue Queue to pop from
+ * @param cmd Receives the command
+ * @return false if the queue is empty
+ */
+static inline bool command_queue_pop(CommandQueue *queue, SynthCommand *cmd)
+{
+    uint32_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    CommandCell *cell;
+
+    for (;;)
+    {
+        cell = &queue->cells[pos & (COMMAND_QUEUE_SIZE - 1)];
+        uint32_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int32_t diff = (int32_t)(seq - (pos + 1));
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // nothing published at this position yet
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *cmd = cell->cmd;
+    atomic_store_explicit(&cell->seq, pos + COMMAND_QUEUE_SIZE, memory_order_release);
+    return true;
+}
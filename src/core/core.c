@@ -10,6 +10,8 @@
 #include "../assets/instruments_core.h"
 #include "../assets/pedal_core.h"
 #include "../utils/note_table.h"
+#include "../oscillators/wavetable.h"
+#include "../filters/svf.h"
 
 #include "pthread.h"
 
@@ -26,8 +28,8 @@ static inline uint64_t GET_TIME_MS()
 }
 #endif
 
-static QSynthError g_last_error = QSYNTH_ERROR_NONE;
-pthread_t voice_dp_generator_workers[MAX_VOICE_ACTIVE];
+static _Thread_local QSynthError g_last_error = QSYNTH_ERROR_NONE; // per thread, control calls may come from many threads
+pthread_t *voice_dp_generator_workers;
 pthread_t voice_mix_worker;
 pthread_t pedal_dp_generator_workers;
 
@@ -37,67 +39,594 @@ static int set_error(QSynthError error)
     return 0;
 }
 
-static void audio_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount)
+// apply master volume and clamp one stereo frame, updates playback stats
+static inline void synth_finish_frame(Synthesizer *synth, qsample *left_ptr, qsample *right_ptr)
 {
-    (void)pInput;
+    double volume = atomic_load_explicit(&synth->master_volume, memory_order_relaxed);
+    double left_mix = *left_ptr * volume;
+    double right_mix = *right_ptr * volume;
+
+    if (left_mix != 0.0 || right_mix != 0.0)
+        synth->samples_played++;
+
+    if (left_mix > 1.0)
+        left_mix = 1.0;
+    if (left_mix < -1.0)
+        left_mix = -1.0;
+    if (right_mix > 1.0)
+        right_mix = 1.0;
+    if (right_mix < -1.0)
+        right_mix = -1.0;
+
+    // update recent sample
+    synth->recent_samples[synth->recent_samples_writeptr] = (int16_t)(left_mix * 32767);
+    synth->recent_samples_writeptr = (synth->recent_samples_writeptr + 1) & RECENT_SAMPLE_MASK;
+
+    synth->recent_samples[synth->recent_samples_writeptr] = (int16_t)(right_mix * 32767);
+    synth->recent_samples_writeptr = (synth->recent_samples_writeptr + 1) & RECENT_SAMPLE_MASK;
+
+    *left_ptr = (qsample)left_mix;
+    *right_ptr = (qsample)right_mix;
+}
 
-    // in our case, frame_count*channel is always AUDIO_BUFFER_SIZE
-    Synthesizer *synth = (Synthesizer *)(pDevice->pUserData);
-    int16_t *output_buffer = (int16_t *)pOutput;
+// write one stereo frame to the s16 device buffer
+static inline void synth_output_frame(Synthesizer *synth, int16_t *frame, qsample left_mix, qsample right_mix)
+{
+    synth_finish_frame(synth, &left_mix, &right_mix);
 
-    if (!synth)
+    // to 16bit
+    frame[0] = (int16_t)(left_mix * 32767);
+    frame[1] = (int16_t)(right_mix * 32767);
+}
+
+// handles are a running counter, the low bits spread consecutive notes over the map
+static void synth_handle_insert(Synthesizer *synth, int handle, int v)
+{
+    int i = handle & synth->handle_mask;
+    while (synth->handle_map[i].handle >= 0)
+        i = (i + 1) & synth->handle_mask;
+
+    synth->handle_map[i].handle = handle;
+    synth->handle_map[i].voice = v;
+}
+
+static int synth_handle_find(const Synthesizer *synth, int handle)
+{
+    for (int i = handle & synth->handle_mask; synth->handle_map[i].handle >= 0; i = (i + 1) & synth->handle_mask)
+    {
+        if (synth->handle_map[i].handle == handle)
+            return i;
+    }
+    return -1;
+}
+
+// drop a handle, later entries of its probe run shift back so lookups never need tombstones
+static void synth_handle_remove(Synthesizer *synth, int handle)
+{
+    int mask = synth->handle_mask;
+    int hole = synth_handle_find(synth, handle);
+    if (hole < 0)
         return;
 
-    for (ma_uint32 i = 0; i < frameCount; i++)
+    for (int i = (hole + 1) & mask; synth->handle_map[i].handle >= 0; i = (i + 1) & mask)
     {
-        double left_mix = 0.0, right_mix = 0.0;
+        // an entry may fill the hole unless its home lies between the hole and itself
+        int home = synth->handle_map[i].handle & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            synth->handle_map[hole] = synth->handle_map[i];
+            hole = i;
+        }
+    }
+    synth->handle_map[hole].handle = -1;
+}
 
-        AudioStreamBuffer *out_stream = &synth->voice_mix_streamer;
+// a threaded voice is done once the mixer drained what its generator thread wrote last,
+// a pull mode voice once its last chunk is rendered
+static bool synth_voice_done(Synthesizer *synth, Voice *voice)
+{
+    if (synth->render_mode == QSYNTH_RENDER_THREADED)
+        return atomic_load_explicit(&voice->stream_stage, memory_order_acquire) == VOICE_STREAM_IDLE;
+    return !atomic_load_explicit(&voice->active, memory_order_acquire);
+}
 
-        // update out stream to be pedal if set
-        if (pedal_chain_size(synth->pedalchain) != 0)
-            out_stream = &synth->pedalchain->streamer;
+// return voices that finished since the last call to the free list, keeps start order
+static void synth_reclaim_voices(Synthesizer *synth)
+{
+    int kept = 0;
 
-        if (stream_available(out_stream) < 2)
+    for (int i = 0; i < synth->active_n; i++)
+    {
+        int v = synth->active_voices[i];
+        if (!synth_voice_done(synth, &synth->voices[v]))
         {
-            uint64_t start_time = GET_TIME_MS();
-            while (stream_available(out_stream) < 2)
-                ;
-            synth->latency_ms += GET_TIME_MS() - start_time;
+            synth->active_voices[kept++] = v;
+            continue;
         }
 
-        left_mix = stream_readDouble(out_stream);
-        right_mix = stream_readDouble(out_stream);
+        synth_handle_remove(synth, synth->voices[v].note_id);
+        synth->free_voices[synth->free_n++] = v;
+    }
+
+    synth->active_n = kept;
+}
+
+// pick a voice to cut off for a new note, returns its position in the active list or -1
+static int synth_pick_steal(Synthesizer *synth)
+{
+    if (synth->active_n == 0)
+        return -1;
 
-        // apply master volume and clamp
-        left_mix *= synth->master_volume;
-        right_mix *= synth->master_volume;
+    switch (synth->steal_policy)
+    {
+    case QSYNTH_STEAL_RELEASED_FIRST:
+        for (int i = 0; i < synth->active_n; i++)
+        {
+            if (synth->voices[synth->active_voices[i]].voice_is_end)
+                return i;
+        }
+        return 0;
+    case QSYNTH_STEAL_OLDEST:
+        return 0;
+    case QSYNTH_STEAL_QUIETEST:
+    {
+        int quietest = 0;
+        double min_level = INFINITY;
+        for (int i = 0; i < synth->active_n; i++)
+        {
+            Voice *voice = &synth->voices[synth->active_voices[i]];
+            double level = voice->envelope.current_level * voice->amplitude;
+            if (level < min_level)
+            {
+                min_level = level;
+                quietest = i;
+            }
+        }
+        return quietest;
+    }
+    default:
+        return -1;
+    }
+}
 
-        if (left_mix != 0.0 || right_mix != 0.0)
-            synth->samples_played++;
+// voice still playing the note behind a handle, NULL once it finished or was stolen
+// only live notes are in the map and handles are not reused, so an old handle cannot reach a newer note
+static Voice *synth_handle_voice(Synthesizer *synth, int handle)
+{
+    int i = synth_handle_find(synth, handle);
+    if (i < 0)
+        return NULL;
 
-        if (left_mix > 1.0)
-            left_mix = 1.0;
-        if (left_mix < -1.0)
-            left_mix = -1.0;
-        if (right_mix > 1.0)
-            right_mix = 1.0;
-        if (right_mix < -1.0)
-            right_mix = -1.0;
+    Voice *voice = &synth->voices[synth->handle_map[i].voice];
+    if (!voice->active || voice->note_id != handle)
+        return NULL;
 
-        // to 16bit
-        output_buffer[i * 2] = (int16_t)(left_mix * 32767);
-        output_buffer[i * 2 + 1] = (int16_t)(right_mix * 32767);
+    return voice;
+}
 
-        // update recent sample
-        synth->recent_samples[synth->recent_samples_writeptr] = output_buffer[i * 2];
-        synth->recent_samples_writeptr = (synth->recent_samples_writeptr + 1) & RECENT_SAMPLE_MASK;
+static void synth_release_note(Synthesizer *synth, int handle)
+{
+    Voice *voice = synth_handle_voice(synth, handle);
+    if (voice)
+        atomic_store_explicit(&voice->release_pending, true, memory_order_release);
+}
 
-        synth->recent_samples[synth->recent_samples_writeptr] = output_buffer[i * 2 + 1];
-        synth->recent_samples_writeptr = (synth->recent_samples_writeptr + 1) & RECENT_SAMPLE_MASK;
+// bind a queued note to a voice, O(1) from the free list unless a voice has to be stolen
+static void synth_apply_note_on(Synthesizer *synth, const SynthCommand *cmd)
+{
+    int handle = cmd->note_on.note_id;
+
+    if (synth->free_n == 0)
+        synth_reclaim_voices(synth);
+
+    int v;
+    if (synth->free_n > 0)
+    {
+        v = synth->free_voices[--synth->free_n];
+    }
+    else
+    {
+        // threaded mode voices are owned by their generator thread while active, never steal there
+        int victim = synth->render_mode == QSYNTH_RENDER_PULL ? synth_pick_steal(synth) : -1;
+        if (victim < 0)
+            return;
+
+        v = synth->active_voices[victim];
+        synth_handle_remove(synth, synth->voices[v].note_id);
+        memmove(&synth->active_voices[victim], &synth->active_voices[victim + 1],
+                (synth->active_n - victim - 1) * sizeof(int));
+        synth->active_n--;
+    }
+
+    Voice *voice = &synth->voices[v];
+    voice_init(voice);
+
+    voice->note_id = cmd->note_on.note_id;
+    voice->duration_ms = cmd->note_on.cfg.duration_ms;
+    voice->tone = cmd->note_on.tone;
+    voice->frequency = cmd->note_on.frequency;
+    voice->amplitude = cmd->note_on.cfg.amplitude;
+    voice->pan = cmd->note_on.cfg.pan;
+    voice->control_mode = cmd->note_on.control_mode;
+    voice->noise_seed = noise_hash(synth->noise_seed, (uint32_t)voice->note_id);
+    voice->filter_coeffs = biquad_cache_get(&synth->filter_cache, &voice->tone->filter_opt, synth->sample_rate);
+
+    // only generator threads stream voices, pull mode renders straight into the block buffers
+    // the stream and its wait events are set up once in synth_init, a free voice's stream is idle
+    bool streamed = synth->render_mode == QSYNTH_RENDER_THREADED;
+    if (streamed)
+    {
+        stream_reset(&voice->streamer);
+        atomic_store_explicit(&voice->stream_stage, VOICE_STREAM_PLAYING, memory_order_release);
+    }
+
+    voice_start(voice, synth->sample_rate);
+    synth->active_voices[synth->active_n++] = v;
+    synth_handle_insert(synth, handle, v);
+
+    // the key moves to the new note only once it plays, a held note on it would be unreachable by key, release it
+    int *key = &synth->key_handles[cmd->note_on.cfg.channel][cmd->note_on.cfg.midi_note];
+    if (*key >= 0)
+    {
+        Voice *held = synth_handle_voice(synth, *key);
+        if (held && held->control_mode == NOTE_CONTROL_MANUAL)
+            atomic_store_explicit(&held->release_pending, true, memory_order_release);
+    }
+    *key = handle;
+
+    // the voice generator thread sleeps while its voice is idle
+    if (streamed)
+        wait_event_wake(&voice->streamer.space_event);
+}
+
+// false if the command has to wait for a later block
+static bool synth_apply_pedal(Synthesizer *synth, const SynthCommand *cmd)
+{
+    PedalChain *chain = synth->pedalchain;
+
+    switch (cmd->type)
+    {
+    case SYNTH_CMD_PEDAL_INSERT:
+        pedal_chain_insert_node(chain, cmd->pedal.idx, cmd->pedal.node);
+        break;
+    case SYNTH_CMD_PEDAL_REMOVE:
+    {
+        // hand the node back, freeing is up to the control side
+        // the render side is the only producer of retired, a node is only unlinked once its slot is sure
+        if (!pedal_chain_get(chain, cmd->pedal.idx))
+            break;
+        if (!command_queue_has_room(&synth->retired))
+            return false;
+
+        SynthCommand retire = {.type = SYNTH_CMD_PEDAL_RETIRE};
+        retire.pedal.node = pedal_chain_unlink(chain, cmd->pedal.idx);
+        command_queue_push(&synth->retired, &retire);
+        break;
+    }
+    case SYNTH_CMD_PEDAL_SWAP:
+        pedal_chain_swap(chain, cmd->pedal.idx, cmd->pedal.idx2);
+        break;
+    case SYNTH_CMD_PEDAL_SET_PARAM:
+    {
+        PedalNode *node = pedal_chain_get(chain, cmd->pedal.idx);
+        if (node)
+            pedal_set_param(node->pedal, cmd->pedal.param_idx, cmd->pedal.value);
+        break;
+    }
+    case SYNTH_CMD_PEDAL_SET_BYPASS:
+    {
+        PedalNode *node = pedal_chain_get(chain, cmd->pedal.idx);
+        if (node)
+            node->pedal->bypass = cmd->pedal.bypass;
+        break;
+    }
+    default:
+        break;
+    }
+    return true;
+}
+
+// false if the command has to wait for a later block
+static bool synth_apply_command(Synthesizer *synth, const SynthCommand *cmd)
+{
+    switch (cmd->type)
+    {
+    case SYNTH_CMD_NOTE_ON:
+        synth_apply_note_on(synth, cmd);
+        break;
+    case SYNTH_CMD_NOTE_OFF:
+        synth_release_note(synth, cmd->note_off.note_id);
+        break;
+    case SYNTH_CMD_NOTE_OFF_KEY:
+    {
+        int *key = &synth->key_handles[cmd->note_off.channel][cmd->note_off.midi_note];
+        if (*key >= 0)
+            synth_release_note(synth, *key);
+        *key = -1;
+        break;
+    }
+    case SYNTH_CMD_MASTER_VOLUME:
+        atomic_store_explicit(&synth->master_volume, cmd->master_volume.volume, memory_order_relaxed);
+        break;
+    default:
+        return synth_apply_pedal(synth, cmd);
+    }
+    return true;
+}
+
+// drain the control queue, runs on the render side before each block
+// commands due after block_start go to the event heap, the scheduling call reserved their slot
+static void synth_apply_commands(Synthesizer *synth, uint64_t block_start)
+{
+    SynthCommand cmd;
+
+    // a held back command keeps everything queued after it waiting, edits apply in order
+    if (synth->has_deferred_cmd)
+    {
+        if (!synth_apply_command(synth, &synth->deferred_cmd))
+            return;
+        synth->has_deferred_cmd = false;
+        if (synth->deferred_cmd.frame_time != 0)
+            atomic_fetch_sub_explicit(&synth->events_pending, 1, memory_order_relaxed);
+    }
+
+    while (command_queue_pop(&synth->commands, &cmd))
+    {
+        if (cmd.frame_time > block_start)
+        {
+            event_heap_push(&synth->events, &cmd);
+            continue;
+        }
+
+        if (!synth_apply_command(synth, &cmd))
+        {
+            synth->deferred_cmd = cmd;
+            synth->has_deferred_cmd = true;
+            return;
+        }
+        if (cmd.frame_time != 0)
+            atomic_fetch_sub_explicit(&synth->events_pending, 1, memory_order_relaxed);
     }
 }
 
+// apply scheduled events due before frame_time
+static void synth_apply_events(Synthesizer *synth, uint64_t frame_time)
+{
+    SynthCommand cmd;
+
+    // only notes are scheduled, they always apply
+    while (event_heap_next_time(&synth->events) < frame_time)
+    {
+        event_heap_pop(&synth->events, &cmd);
+        synth_apply_command(synth, &cmd);
+        atomic_fetch_sub_explicit(&synth->events_pending, 1, memory_order_relaxed);
+    }
+}
+
+// DSP pool job: render a voice group, or one voice that fits no group, into the block buffers
+static void synth_render_voice_job(void *ctx, int job_idx)
+{
+    Synthesizer *synth = (Synthesizer *)ctx;
+
+    if (job_idx < synth->group_n)
+    {
+        synth->kernels->voice_group_render(&synth->voice_groups[job_idx], synth->voices, synth->voice_block,
+                                           synth->render_frames);
+        return;
+    }
+
+    int v = synth->solo_voices[job_idx - synth->group_n];
+    if (!voice_render_block(&synth->voices[v], &synth->voice_block[v * RENDER_BLOCK_SIZE], synth->render_frames))
+        voice_retire(&synth->voices[v]);
+}
+
+// pack active voices with the same plan shape into groups, a group of one is cheaper on the scalar path
+static void synth_group_voices(Synthesizer *synth)
+{
+    synth->group_n = 0;
+    synth->solo_n = 0;
+
+    for (int j = 0; j < synth->active_n; j++)
+    {
+        int v = synth->active_voices[j];
+        Voice *voice = &synth->voices[v];
+
+        if (!voice->active || !voice_bank_accepts(voice))
+        {
+            synth->solo_voices[synth->solo_n++] = v;
+            continue;
+        }
+
+        int g = 0;
+        while (g < synth->group_n && !voice_group_fits(&synth->voice_groups[g], voice))
+            g++;
+        if (g == synth->group_n)
+            synth->voice_groups[synth->group_n++].lane_n = 0;
+
+        voice_group_add(&synth->voice_groups[g], voice, v);
+    }
+
+    int kept = 0;
+    for (int g = 0; g < synth->group_n; g++)
+    {
+        if (synth->voice_groups[g].lane_n == 1)
+            synth->solo_voices[synth->solo_n++] = synth->voice_groups[g].voices[0];
+        else
+            synth->voice_groups[kept++] = synth->voice_groups[g];
+    }
+    synth->group_n = kept;
+}
+
+// render voices, mix and pedal chain for a span without events
+static void synth_render_span(Synthesizer *synth, qsample *left, qsample *right, int frames)
+{
+    int job_n = synth->active_n;
+
+    synth->render_frames = frames;
+    synth_group_voices(synth);
+
+    // voices render in parallel, the pool returns once every job is done
+    dsp_pool_run(synth->dsp_pool, synth_render_voice_job, synth, synth->group_n + synth->solo_n);
+
+    memset(left, 0, frames * sizeof(qsample));
+    memset(right, 0, frames * sizeof(qsample));
+
+    for (int j = 0; j < job_n; j++)
+    {
+        int v = synth->active_voices[j];
+        Voice *voice = &synth->voices[v];
+        const float *block = &synth->voice_block[v * RENDER_BLOCK_SIZE];
+
+        // apply panning
+        if (mod_routes(&voice->mod, MOD_DST_PAN))
+            synth->kernels->mix_pan_buffer(left, right, block, voice->pan_block, frames);
+        else
+            synth->kernels->mix_pan(left, right, block, (qsample)(1.0 - voice->pan), (qsample)voice->pan, frames);
+    }
+
+    // voices that finished in this span go back to the pool
+    synth_reclaim_voices(synth);
+    synth->voice_active = synth->active_n;
+
+    if (pedal_chain_size(synth->pedalchain) != 0)
+    {
+        for (int i = 0; i < frames; i++)
+            pedal_chain_process(synth->pedalchain, &left[i], &right[i]);
+    }
+}
+
+// render one block (frames <= RENDER_BLOCK_SIZE), split at every scheduled event inside it
+static void synth_render_block(Synthesizer *synth, qsample *left, qsample *right, int frames)
+{
+    uint64_t block_start = atomic_load_explicit(&synth->frame_clock, memory_order_relaxed);
+    uint64_t block_end = block_start + frames;
+    int done = 0;
+
+    synth_apply_commands(synth, block_start);
+
+    while (done < frames)
+    {
+        synth_apply_events(synth, block_start + done + 1);
+
+        uint64_t next_event = event_heap_next_time(&synth->events);
+        int span = frames - done;
+        if (next_event < block_end)
+            span = (int)(next_event - (block_start + done));
+
+        synth_render_span(synth, left + done, right + done, span);
+        done += span;
+    }
+
+    atomic_store_explicit(&synth->frame_clock, block_end, memory_order_relaxed);
+}
+
+static void audio_callback_pull(Synthesizer *synth, int16_t *output_buffer, ma_uint32 frameCount)
+{
+    ma_uint32 done = 0;
+
+    while (done < frameCount)
+    {
+        int frames = frameCount - done > RENDER_BLOCK_SIZE ? RENDER_BLOCK_SIZE : (int)(frameCount - done);
+
+        synth_render_block(synth, synth->mix_left, synth->mix_right, frames);
+
+        for (int i = 0; i < frames; i++)
+            synth_output_frame(synth, &output_buffer[(done + i) * 2], synth->mix_left[i], synth->mix_right[i]);
+
+        done += frames;
+    }
+}
+
+// wait conditions of the threaded pipeline, all of them give up once the pipeline stops
+struct pipeline_wait_ctx
+{
+    Synthesizer *synth;
+    Voice *voice;
+};
+
+static bool voice_needs_refill(void *arg)
+{
+    struct pipeline_wait_ctx *ctx = (struct pipeline_wait_ctx *)arg;
+    if (!ctx->synth->voice_dp_generator_running)
+        return true;
+
+    return ctx->voice->active && stream_fillRatio(&ctx->voice->streamer) <= VOICE_BUFFER_REFILL_THRESHOLD;
+}
+
+static bool voice_stream_closed(void *arg)
+{
+    struct pipeline_wait_ctx *ctx = (struct pipeline_wait_ctx *)arg;
+    return !ctx->voice->active || !ctx->synth->voice_mix_generator_running;
+}
+
+static bool voice_mix_needs_refill(void *arg)
+{
+    Synthesizer *synth = (Synthesizer *)arg;
+    return !synth->voice_mix_generator_running ||
+           stream_fillRatio(&synth->voice_mix_streamer) <= VOICE_MIX_BUFFER_REFILL_THRESHOLD;
+}
+
+static bool pedal_needs_refill(void *arg)
+{
+    Synthesizer *synth = (Synthesizer *)arg;
+    return !synth->pedal_dp_generator_running ||
+           stream_fillRatio(&synth->pedalchain->streamer) <= PEDALCHAIN_BUFFER_REFILL_THRESHOLD;
+}
+
+static bool pedal_stopped(void *arg)
+{
+    Synthesizer *synth = (Synthesizer *)arg;
+    return !synth->pedal_dp_generator_running;
+}
+
+static void audio_callback_threaded(Synthesizer *synth, int16_t *output_buffer, ma_uint32 frameCount)
+{
+    qsample block[RENDER_BLOCK_SIZE * 2];
+    AudioStreamBuffer *out_stream = &synth->pedalchain->streamer;
+    ma_uint32 done = 0;
+
+    while (done < frameCount)
+    {
+        uint32_t frames = frameCount - done > RENDER_BLOCK_SIZE ? RENDER_BLOCK_SIZE : frameCount - done;
+
+        uint32_t got = stream_read_block(out_stream, block, frames * 2);
+        if (got < frames * 2)
+        {
+            uint64_t start_time = GET_TIME_MS();
+            while (got < frames * 2 && synth->pedal_dp_generator_running)
+            {
+                stream_wait_available(out_stream, frames * 2 - got, pedal_stopped, synth);
+                got += stream_read_block(out_stream, block + got, frames * 2 - got);
+            }
+            synth->latency_ms += GET_TIME_MS() - start_time;
+
+            // pipeline shutting down
+            memset(block + got, 0, (frames * 2 - got) * sizeof(qsample));
+        }
+
+        for (uint32_t i = 0; i < frames; i++)
+            synth_output_frame(synth, &output_buffer[(done + i) * 2], block[i * 2], block[i * 2 + 1]);
+
+        done += frames;
+    }
+}
+
+static void audio_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount)
+{
+    (void)pInput;
+
+    Synthesizer *synth = (Synthesizer *)(pDevice->pUserData);
+    int16_t *output_buffer = (int16_t *)pOutput;
+
+    if (!synth)
+        return;
+
+    if (synth->render_mode == QSYNTH_RENDER_PULL)
+        audio_callback_pull(synth, output_buffer, frameCount);
+    else
+        audio_callback_threaded(synth, output_buffer, frameCount);
+}
+
 struct voice_dp_generator_args
 {
     Synthesizer *synth;
@@ -115,18 +644,44 @@ static void *voice_dp_generator(void *arg)
         return NULL;
 
     Voice *voice = &synth->voices[voice_index];
+    float block[RENDER_BLOCK_SIZE];
+    qsample samples[RENDER_BLOCK_SIZE];
+    struct pipeline_wait_ctx ctx = {synth, voice};
 
     while (synth->voice_dp_generator_running)
     {
-        if (voice->active && stream_fillRatio(&voice->streamer) <= VOICE_BUFFER_REFILL_THRESHOLD)
+        // sleep until the voice plays and the mixer drained its stream below the refill threshold
+        uint32_t target = atomic_load(&voice->streamer.write_pos) - (uint32_t)(VOICE_BUFFER_SIZE * VOICE_BUFFER_REFILL_THRESHOLD);
+        wait_event_wait(&voice->streamer.space_event, target, voice_needs_refill, &ctx);
+
+        int refill_count = 0;
+        while (voice->active && refill_count < VOICE_REFILL_CHUNK_SIZE)
         {
-            int refill_count = 0;
-            while (stream_space(&voice->streamer) > 0 && refill_count++ < VOICE_REFILL_CHUNK_SIZE)
+            int frames = (int)stream_space(&voice->streamer);
+            if (frames > RENDER_BLOCK_SIZE)
+                frames = RENDER_BLOCK_SIZE;
+            if (frames == 0)
+                break;
+
+            bool sounding = voice_render_block(voice, block, frames);
+            for (int i = 0; i < frames; i++)
+                samples[i] = block[i];
+
+            stream_write_block(&voice->streamer, samples, frames);
+            refill_count += frames;
+
+            // flagged only once the tail is in the stream, the mixer reads until it sees the flag
+            // the generator never touches the stream again, the mixer hands the voice back once drained
+            if (!sounding)
             {
-                stream_writeDouble(&voice->streamer, voice_step(voice, synth->delta_time));
+                voice_retire(voice);
+                atomic_store_explicit(&voice->stream_stage, VOICE_STREAM_ENDED, memory_order_release);
             }
         }
-        SLEEP_MS(1);
+
+        // the mixer may be waiting for samples this voice will never produce
+        if (!voice->active)
+            wait_event_wake(&voice->streamer.data_event);
     }
 
     return NULL;
@@ -139,51 +694,73 @@ static void *voice_mix_generator(void *arg)
     if (!synth)
         return NULL;
 
+    qsample voice_buf[RENDER_BLOCK_SIZE];
+    qsample mix_buf[RENDER_BLOCK_SIZE * 2];
+
     while (synth->voice_mix_generator_running)
     {
+        // positions are free running, a constant target stops matching once the reader passes 2^31
+        AudioStreamBuffer *mix_stream = &synth->voice_mix_streamer;
+        uint32_t target = atomic_load(&mix_stream->write_pos) - (uint32_t)(mix_stream->size * VOICE_MIX_BUFFER_REFILL_THRESHOLD);
+        wait_event_wait(&mix_stream->space_event, target, voice_mix_needs_refill, synth);
 
-        if (stream_fillRatio(&synth->voice_mix_streamer) <= VOICE_MIX_BUFFER_REFILL_THRESHOLD)
+        int refill_count = 0;
+        while (synth->voice_mix_generator_running && refill_count < VOICE_MIX_REFILL_CHUNK_SIZE)
         {
-            int refill_count = 0;
-            while (stream_space(&synth->voice_mix_streamer) >= 2 && refill_count++ < VOICE_MIX_REFILL_CHUNK_SIZE)
-            {
-                double left_mix = 0.0, right_mix = 0.0;
-                int voice_active = 0;
+            uint32_t frames = stream_space(&synth->voice_mix_streamer) / 2;
+            if (frames > RENDER_BLOCK_SIZE)
+                frames = RENDER_BLOCK_SIZE;
+            if (frames == 0)
+                break;
 
-                for (int v = 0; v < MAX_VOICE_ACTIVE; v++)
-                {
-                    Voice *voice = &synth->voices[v];
-                    if (!voice->active)
-                        continue;
+            int voice_active = 0;
+            memset(mix_buf, 0, frames * 2 * sizeof(qsample));
 
-                    voice_active++;
+            for (int v = 0; v < synth->voice_n; v++)
+            {
+                Voice *voice = &synth->voices[v];
+                int stage = atomic_load_explicit(&voice->stream_stage, memory_order_acquire);
+                if (stage == VOICE_STREAM_IDLE)
+                    continue;
 
-                    while (voice->active && stream_available(&voice->streamer) == 0)
-                        ;
+                voice_active++;
 
-                    double sample = stream_readDouble(&voice->streamer);
+                // wait for the whole block, a voice that finished only delivers its tail
+                struct pipeline_wait_ctx ctx = {synth, voice};
+                uint32_t got = stream_read_block(&voice->streamer, voice_buf, frames);
+                while (got < frames && !voice_stream_closed(&ctx))
+                {
+                    stream_wait_available(&voice->streamer, frames - got, voice_stream_closed, &ctx);
+                    got += stream_read_block(&voice->streamer, voice_buf + got, frames - got);
+                }
+                got += stream_read_block(&voice->streamer, voice_buf + got, frames - got);
 
-                    // apply panning
-                    double left_gain = 1.0 - voice->pan;
-                    double right_gain = voice->pan;
+                // apply panning
+                qsample left_gain = (qsample)(1.0 - voice->pan);
+                qsample right_gain = (qsample)voice->pan;
 
-                    left_mix += sample * left_gain;
-                    right_mix += sample * right_gain;
+                for (uint32_t i = 0; i < got; i++)
+                {
+                    mix_buf[i * 2] += voice_buf[i] * left_gain;
+                    mix_buf[i * 2 + 1] += voice_buf[i] * right_gain;
                 }
 
-                synth->voice_active = voice_active;
-
-                stream_writeDouble(&synth->voice_mix_streamer, left_mix);
-                stream_writeDouble(&synth->voice_mix_streamer, right_mix);
+                // the tail is mixed and nobody uses the stream any more, the control side may reuse the voice
+                if (stage == VOICE_STREAM_ENDED && stream_isEmpty(&voice->streamer))
+                    atomic_store_explicit(&voice->stream_stage, VOICE_STREAM_IDLE, memory_order_release);
             }
-        }
 
-        SLEEP_MS(1);
+            synth->voice_active = voice_active;
+
+            stream_write_block(&synth->voice_mix_streamer, mix_buf, frames * 2);
+            refill_count += frames;
+        }
     }
 
     return NULL;
 }
 
+// sole consumer of the mix stream, an empty chain passes the mix through
 static void *pedal_dp_generator(void *arg)
 {
     Synthesizer *synth = (Synthesizer *)arg;
@@ -191,33 +768,101 @@ static void *pedal_dp_generator(void *arg)
     if (!synth)
         return NULL;
 
+    qsample block[RENDER_BLOCK_SIZE * 2];
+
     while (synth->pedal_dp_generator_running)
     {
-        if (synth->pedalchain && stream_fillRatio(&synth->pedalchain->streamer) <= PEDALCHAIN_BUFFER_REFILL_THRESHOLD)
+        AudioStreamBuffer *out_stream = &synth->pedalchain->streamer;
+        uint32_t target = atomic_load(&out_stream->write_pos) - (uint32_t)(out_stream->size * PEDALCHAIN_BUFFER_REFILL_THRESHOLD);
+        wait_event_wait(&out_stream->space_event, target, pedal_needs_refill, synth);
+
+        int refill_count = 0;
+        while (synth->pedal_dp_generator_running && refill_count < PEDALCHAIN_REFILL_CHUNK_SIZE)
         {
-            int refill_count = 0;
-            while (stream_space(&synth->pedalchain->streamer) >= 2 && refill_count++ < PEDALCHAIN_REFILL_CHUNK_SIZE)
+            uint32_t frames = stream_space(&synth->pedalchain->streamer) / 2;
+            if (frames > RENDER_BLOCK_SIZE)
+                frames = RENDER_BLOCK_SIZE;
+            if (frames == 0)
+                break;
+
+            // the pedal thread owns the chain and the end of the pipeline, it applies control commands
+            // voices run ahead in their own streams, so scheduled events are only block accurate here
+            uint64_t block_start = atomic_load_explicit(&synth->frame_clock, memory_order_relaxed);
+            uint64_t block_end = block_start + frames;
+            synth_apply_commands(synth, block_start);
+            synth_apply_events(synth, block_end);
+
+            uint32_t got = stream_read_block(&synth->voice_mix_streamer, block, frames * 2);
+            while (got < frames * 2 && synth->pedal_dp_generator_running)
             {
-                while (stream_available(&synth->voice_mix_streamer) < 2)
-                    ;
-
-                double sample_left = stream_readDouble(&synth->voice_mix_streamer);
-                double sample_right = stream_readDouble(&synth->voice_mix_streamer);
+                stream_wait_available(&synth->voice_mix_streamer, frames * 2 - got, pedal_stopped, synth);
+                got += stream_read_block(&synth->voice_mix_streamer, block + got, frames * 2 - got);
+            }
+            if (got < frames * 2)
+                break;
 
-                pedal_chain_process(synth->pedalchain, &sample_left, &sample_right);
+            for (uint32_t i = 0; i < frames; i++)
+                pedal_chain_process(synth->pedalchain, &block[i * 2], &block[i * 2 + 1]);
 
-                stream_writeDouble(&synth->pedalchain->streamer, sample_left);
-                stream_writeDouble(&synth->pedalchain->streamer, sample_right);
-            }
+            stream_write_block(&synth->pedalchain->streamer, block, frames * 2);
+            atomic_store_explicit(&synth->frame_clock, block_end, memory_order_relaxed);
+            refill_count += frames;
         }
-        SLEEP_MS(1);
     }
 
     return NULL;
 }
 
-static bool synth_precheck(double sample_rate, int channels)
+static void synth_free_pedal_node(PedalNode *node)
 {
+    pedal_destroy(node->pedal);
+    free(node);
+}
+
+// free pedals the render side unlinked, control side only
+static void synth_collect_retired(Synthesizer *synth)
+{
+    SynthCommand cmd;
+    while (command_queue_pop(&synth->retired, &cmd))
+        synth_free_pedal_node(cmd.pedal.node);
+}
+
+static bool synth_push_command(Synthesizer *synth, const SynthCommand *cmd)
+{
+    if (command_queue_push(&synth->commands, cmd))
+        return true;
+
+    printf("WARNING: command queue full, is the synth rendering?\n");
+    set_error(QSYNTH_ERROR_QUEUE_FULL);
+    return false;
+}
+
+// queue a command with a frame time, a slot of the event heap is held until the render side applies it
+static bool synth_push_scheduled(Synthesizer *synth, const SynthCommand *cmd)
+{
+    if (cmd->frame_time == 0)
+        return synth_push_command(synth, cmd);
+
+    if (atomic_fetch_add_explicit(&synth->events_pending, 1, memory_order_relaxed) >= EVENT_QUEUE_SIZE)
+    {
+        atomic_fetch_sub_explicit(&synth->events_pending, 1, memory_order_relaxed);
+        printf("WARNING: event queue full (%d scheduled events)\n", EVENT_QUEUE_SIZE);
+        set_error(QSYNTH_ERROR_QUEUE_FULL);
+        return false;
+    }
+
+    if (synth_push_command(synth, cmd))
+        return true;
+
+    atomic_fetch_sub_explicit(&synth->events_pending, 1, memory_order_relaxed);
+    return false;
+}
+
+static bool synth_precheck(const QSynthCfg *cfg)
+{
+    double sample_rate = cfg->sample_rate;
+    int channels = cfg->channels;
+
     if (!(VOICE_BUFFER_SIZE > 0 && (VOICE_BUFFER_SIZE & (VOICE_BUFFER_SIZE - 1)) == 0))
     {
         printf("VOICE_BUFFER_SIZE must be a power of 2\n");
@@ -244,13 +889,77 @@ static bool synth_precheck(double sample_rate, int channels)
         return false;
     }
 
+    if (cfg->render_mode != QSYNTH_RENDER_PULL && cfg->render_mode != QSYNTH_RENDER_THREADED)
+    {
+        printf("unknown render mode (%d)\n", cfg->render_mode);
+        set_error(QSYNTH_ERROR_CONFIG);
+        return false;
+    }
+
+    if (cfg->voice_n < 0 || cfg->voice_n > MAX_VOICE_LIMIT)
+    {
+        printf("voice count must be between 1 and %d, your set to %d\n", MAX_VOICE_LIMIT, cfg->voice_n);
+        set_error(QSYNTH_ERROR_CONFIG);
+        return false;
+    }
+
+    if (cfg->steal_policy < QSYNTH_STEAL_RELEASED_FIRST || cfg->steal_policy > QSYNTH_STEAL_NONE)
+    {
+        printf("unknown voice steal policy (%d)\n", cfg->steal_policy);
+        set_error(QSYNTH_ERROR_CONFIG);
+        return false;
+    }
+
+    if (cfg->headless && cfg->render_mode != QSYNTH_RENDER_PULL)
+    {
+        printf("headless synth only supports pull render mode\n");
+        set_error(QSYNTH_ERROR_CONFIG);
+        return false;
+    }
+
     printf("QSynth pre-check passed\n");
     return true;
 }
 
+QSynthCfg synth_default_cfg(double sample_rate, int channels)
+{
+    return (QSynthCfg){
+        .sample_rate = sample_rate,
+        .channels = channels,
+        .render_mode = QSYNTH_RENDER_PULL,
+        .voice_n = MAX_VOICE_ACTIVE,
+        .steal_policy = QSYNTH_STEAL_RELEASED_FIRST,
+        .worker_n = 0,
+        .headless = false,
+        .noise_seed = QSYNTH_NOISE_SEED,
+    };
+}
+
 bool synth_init(Synthesizer **synth_ptr, double sample_rate, int channels)
 {
-    if (!synth_precheck(sample_rate, channels))
+    QSynthCfg cfg = synth_default_cfg(sample_rate, channels);
+    return synth_init_cfg(synth_ptr, &cfg);
+}
+
+bool synth_init_offline(Synthesizer **synth_ptr, double sample_rate, int channels)
+{
+    QSynthCfg cfg = synth_default_cfg(sample_rate, channels);
+    cfg.headless = true;
+    return synth_init_cfg(synth_ptr, &cfg);
+}
+
+bool synth_init_cfg(Synthesizer **synth_ptr, const QSynthCfg *cfg)
+{
+    if (!cfg)
+    {
+        set_error(QSYNTH_ERROR_CONFIG);
+        return false;
+    }
+
+    double sample_rate = cfg->sample_rate;
+    int channels = cfg->channels;
+
+    if (!synth_precheck(cfg))
     {
         printf("QSynth pre-check failed\n");
         return false;
@@ -259,6 +968,12 @@ bool synth_init(Synthesizer **synth_ptr, double sample_rate, int channels)
     // init note table
     init_note_table();
 
+    // init bandlimited oscillator tables
+    wavetable_init();
+
+    // init state variable filter tan table
+    svf_tables_init();
+
     // init synthesizer
     Synthesizer *synth = (Synthesizer *)calloc(1, sizeof(Synthesizer));
     if (!synth)
@@ -268,44 +983,128 @@ bool synth_init(Synthesizer **synth_ptr, double sample_rate, int channels)
     };
 
     *synth_ptr = synth;
+    synth->headless = cfg->headless;
 
     // init audio device
-    ma_device_config deviceConfig;
+    if (!synth->headless)
+    {
+        ma_device_config deviceConfig;
 
-    deviceConfig = ma_device_config_init(ma_device_type_playback);
-    deviceConfig.playback.format = ma_format_s16;
-    deviceConfig.playback.channels = channels;
-    deviceConfig.sampleRate = sample_rate;
-    deviceConfig.dataCallback = audio_callback;
-    deviceConfig.pUserData = synth;
+        deviceConfig = ma_device_config_init(ma_device_type_playback);
+        deviceConfig.playback.format = ma_format_s16;
+        deviceConfig.playback.channels = channels;
+        deviceConfig.sampleRate = sample_rate;
+        deviceConfig.dataCallback = audio_callback;
+        deviceConfig.pUserData = synth;
 
-    ma_result ret = ma_device_init(NULL, &deviceConfig, &synth->device);
+        ma_result ret = ma_device_init(NULL, &deviceConfig, &synth->device);
 
-    if (ret != MA_SUCCESS)
+        if (ret != MA_SUCCESS)
+        {
+            set_error(QSYNTH_ERROR_DEVICE);
+            printf("audio device init failed: %s\n", ma_result_description(ret));
+            return false;
+        }
+    }
+
+    // init voice pool
+    int voice_n = cfg->voice_n > 0 ? cfg->voice_n : MAX_VOICE_ACTIVE;
+    synth->voices = calloc(voice_n, sizeof(Voice));
+    synth->free_voices = malloc(voice_n * sizeof(int));
+    synth->active_voices = malloc(voice_n * sizeof(int));
+    synth->voice_block = calloc((size_t)voice_n * RENDER_BLOCK_SIZE, sizeof(float));
+    synth->voice_groups = malloc(voice_n * sizeof(VoiceGroup));
+    synth->solo_voices = malloc(voice_n * sizeof(int));
+    synth->voice_stream_bufs = calloc((size_t)voice_n * VOICE_BUFFER_SIZE, sizeof(qsample));
+
+    // at most half full, probe runs stay short
+    int handle_map_size = 1;
+    while (handle_map_size < 2 * voice_n)
+        handle_map_size <<= 1;
+    synth->handle_map = malloc(handle_map_size * sizeof(NoteHandleEntry));
+    synth->handle_mask = handle_map_size - 1;
+
+    if (!synth->voices || !synth->free_voices || !synth->active_voices || !synth->voice_block ||
+        !synth->voice_groups || !synth->solo_voices || !synth->voice_stream_bufs || !synth->handle_map)
     {
-        set_error(QSYNTH_ERROR_DEVICE);
-        printf("audio device init failed: %s\n", ma_result_description(ret));
+        set_error(QSYNTH_ERROR_MEMALLOC);
+        printf("voice pool allocation failed (%d voices)\n", voice_n);
         return false;
     }
 
-    // init voice
-    for (int i = 0; i < MAX_VOICE_ACTIVE; i++)
+    synth->voice_n = voice_n;
+    synth->steal_policy = cfg->steal_policy;
+    synth->noise_seed = cfg->noise_seed;
+    for (int i = 0; i < synth->voice_n; i++)
     {
         voice_init(&synth->voices[i]);
+        stream_init(&synth->voices[i].streamer, &synth->voice_stream_bufs[(size_t)i * VOICE_BUFFER_SIZE], VOICE_BUFFER_SIZE);
+        atomic_init(&synth->voices[i].stream_stage, VOICE_STREAM_IDLE);
+
+        // lowest index on top of the stack
+        synth->free_voices[i] = synth->voice_n - 1 - i;
     }
+    synth->free_n = synth->voice_n;
+    synth->active_n = 0;
+
+    for (int i = 0; i <= synth->handle_mask; i++)
+        synth->handle_map[i].handle = -1;
+    memset(synth->key_handles, -1, sizeof(synth->key_handles));
 
     // init voice mix streamer
     stream_init(&synth->voice_mix_streamer, synth->voice_mix_buf, VOICE_MIX_BUFFER_SIZE);
 
     // init global settings
     synth->master_volume = 0.5;
+    synth->render_mode = cfg->render_mode;
 
     // pre-compute attributes
+    synth->sample_rate = sample_rate;
     synth->delta_time = 1.0 / sample_rate;
 
+    // design the filter of every instrument once, note on only looks them up
+    synth->filter_cache.n = 0;
+    for (int i = 0; i < INST_COUNT; i++)
+        biquad_cache_get(&synth->filter_cache, &instrument_get_signature((InstrumentType)i)->tone.filter_opt, sample_rate);
+
     // init pedal chain
     pedal_chain_create(&synth->pedalchain);
 
+    // init control path
+    command_queue_init(&synth->commands);
+    command_queue_init(&synth->retired);
+    synth->has_deferred_cmd = false;
+    event_heap_init(&synth->events);
+    atomic_init(&synth->frame_clock, 0);
+    atomic_init(&synth->events_pending, 0);
+    atomic_init(&synth->next_note_id, 0);
+    pthread_mutex_init(&synth->ctrl_lock, NULL);
+    synth->ctrl_pedal_n = 0;
+
+    // pick the SIMD kernels once, the render path only follows the table
+    synth->kernels = dsp_kernels_select();
+    printf("DSP kernels: %s (cpu supports %s)\n", synth->kernels->name, dsp_isa_name(dsp_isa_detect()));
+
+    // voice_kernels.h is written by hand, name any built-in instrument it misses
+    for (int i = 0; i < INST_COUNT; i++)
+    {
+        const InstrumentSignature *sig = instrument_get_signature((InstrumentType)i);
+        if (!voice_tone_is_fused(&sig->tone, sample_rate))
+            printf("WARNING: %s has no fused voice kernel, add its layers to voice_kernels.h\n", sig->name);
+    }
+
+    // init DSP worker pool for pull mode
+    if (synth->render_mode == QSYNTH_RENDER_PULL)
+    {
+        if (!dsp_pool_create(&synth->dsp_pool, cfg->worker_n))
+        {
+            set_error(QSYNTH_ERROR_WORKER);
+            printf("DSP worker pool init failed\n");
+            return false;
+        }
+        printf("DSP worker pool created with %d workers\n", synth->dsp_pool->worker_n);
+    }
+
     // init state
     synth->samples_played = 0;
     synth->voice_dp_generator_running = false;
@@ -316,7 +1115,9 @@ bool synth_init(Synthesizer **synth_ptr, double sample_rate, int channels)
     memset(synth->recent_samples, 0, sizeof(synth->recent_samples));
     synth->recent_samples_writeptr = 0;
 
-    printf("QSynth initialized: %.1fHz, %d channels\n", sample_rate, channels);
+    printf("QSynth initialized: %.1fHz, %d channels, %s render%s\n", sample_rate, channels,
+           synth->render_mode == QSYNTH_RENDER_PULL ? "pull" : "threaded",
+           synth->headless ? " (headless)" : "");
     return true;
 }
 
@@ -325,7 +1126,7 @@ void synth_cleanup(Synthesizer *synth)
     if (!synth)
         return;
 
-    if (ma_device_is_started(&synth->device))
+    if (!synth->headless && ma_device_is_started(&synth->device))
         synth_stop(synth);
 
     // join pedal dp generator thread
@@ -333,6 +1134,8 @@ void synth_cleanup(Synthesizer *synth)
     if (synth->pedal_dp_generator_running)
     {
         synth->pedal_dp_generator_running = false;
+        stream_wake(&synth->voice_mix_streamer);
+        stream_wake(&synth->pedalchain->streamer);
         pthread_join(pedal_dp_generator_workers, NULL);
     }
     printf("pedal DP generator thread exiting\n");
@@ -342,6 +1145,9 @@ void synth_cleanup(Synthesizer *synth)
     if (synth->voice_mix_generator_running)
     {
         synth->voice_mix_generator_running = false;
+        stream_wake(&synth->voice_mix_streamer);
+        for (int i = 0; i < synth->voice_n; i++)
+            stream_wake(&synth->voices[i].streamer);
         pthread_join(voice_mix_worker, NULL);
     }
     printf("Voice mix generator thread exiting\n");
@@ -351,24 +1157,61 @@ void synth_cleanup(Synthesizer *synth)
     if (synth->voice_dp_generator_running)
     {
         synth->voice_dp_generator_running = false;
-        for (int i = 0; i < MAX_VOICE_ACTIVE; i++)
+        for (int i = 0; i < synth->voice_n; i++)
+            stream_wake(&synth->voices[i].streamer);
+        for (int i = 0; i < synth->voice_n; i++)
         {
             pthread_join(voice_dp_generator_workers[i], NULL);
         }
     }
     printf("Voice DP generator thread exiting\n");
 
-    ma_device_uninit(&synth->device);
+    if (!synth->headless)
+        ma_device_uninit(&synth->device);
+
+    // join DSP pool workers, the device is stopped so nobody dispatches anymore
+    dsp_pool_destroy(synth->dsp_pool);
+
+    for (int i = 0; i < synth->voice_n; i++)
+        stream_destroy(&synth->voices[i].streamer);
+    stream_destroy(&synth->voice_mix_streamer);
+
+    // commands that never reached the render side may still own pedals
+    SynthCommand cmd;
+    while (command_queue_pop(&synth->commands, &cmd))
+    {
+        if (cmd.type == SYNTH_CMD_PEDAL_INSERT)
+            synth_free_pedal_node(cmd.pedal.node);
+    }
+    synth_collect_retired(synth);
+    pthread_mutex_destroy(&synth->ctrl_lock);
 
     // destory pedals and pedal chain
     pedal_chain_destroy(synth->pedalchain, true);
 
+    free(voice_dp_generator_workers);
+    voice_dp_generator_workers = NULL;
+    free(synth->voices);
+    free(synth->free_voices);
+    free(synth->active_voices);
+    free(synth->voice_block);
+    free(synth->voice_groups);
+    free(synth->solo_voices);
+    free(synth->voice_stream_bufs);
+    free(synth->handle_map);
+
     free(synth);
     printf("QSynth cleaned up\n");
 }
 
 bool synth_start(Synthesizer *synth)
 {
+    if (synth->headless)
+    {
+        printf("headless synth has no device to start, render with synth_render\n");
+        return true;
+    }
+
     ma_result ret = ma_device_start(&synth->device);
 
     if (ret != MA_SUCCESS)
@@ -377,9 +1220,23 @@ bool synth_start(Synthesizer *synth)
         return false;
     }
 
+    // pull mode renders inside the audio callback, no workers needed
+    if (synth->render_mode == QSYNTH_RENDER_PULL)
+    {
+        printf("Audio playback started\n");
+        return true;
+    }
+
     // start voice DP generator thread
+    voice_dp_generator_workers = calloc(synth->voice_n, sizeof(pthread_t));
+    if (!voice_dp_generator_workers)
+    {
+        set_error(QSYNTH_ERROR_MEMALLOC);
+        return false;
+    }
+
     synth->voice_dp_generator_running = true;
-    for (int i = 0; i < MAX_VOICE_ACTIVE; i++)
+    for (int i = 0; i < synth->voice_n; i++)
     {
         struct voice_dp_generator_args *args = malloc(sizeof(struct voice_dp_generator_args));
         args->synth = synth;
@@ -395,7 +1252,7 @@ bool synth_start(Synthesizer *synth)
             return false;
         }
     }
-    printf("Voice DP generator threads(%zu) created\n", sizeof(voice_dp_generator_workers) / sizeof(pthread_t));
+    printf("Voice DP generator threads(%d) created\n", synth->voice_n);
 
     // start voice mix worker
     synth->voice_mix_generator_running = true;
@@ -427,7 +1284,7 @@ bool synth_start(Synthesizer *synth)
 
 void synth_stop(Synthesizer *synth)
 {
-    if (!synth)
+    if (!synth || synth->headless)
         return;
 
     ma_device_stop(&synth->device);
@@ -435,15 +1292,55 @@ void synth_stop(Synthesizer *synth)
     printf("qsynth stop.\n");
 }
 
+bool synth_render(Synthesizer *synth, float *interleaved_out, uint32_t frames)
+{
+    if (!synth)
+    {
+        set_error(QSYNTH_ERROR_UNINIT);
+        return false;
+    }
+
+    if (!synth->headless)
+    {
+        printf("synth_render needs a headless synth, the device callback owns this one\n");
+        set_error(QSYNTH_ERROR_UNSUPPORT);
+        return false;
+    }
+
+    uint32_t done = 0;
+
+    while (done < frames)
+    {
+        int block = frames - done > RENDER_BLOCK_SIZE ? RENDER_BLOCK_SIZE : (int)(frames - done);
+
+        synth_render_block(synth, synth->mix_left, synth->mix_right, block);
+
+        for (int i = 0; i < block; i++)
+        {
+            qsample left_mix = synth->mix_left[i];
+            qsample right_mix = synth->mix_right[i];
+
+            synth_finish_frame(synth, &left_mix, &right_mix);
+
+            interleaved_out[(done + i) * 2] = (float)left_mix;
+            interleaved_out[(done + i) * 2 + 1] = (float)right_mix;
+        }
+
+        done += block;
+    }
+
+    return true;
+}
+
 QSynthStat synth_get_stat(Synthesizer *synth)
 {
 
-    ma_device_state device_state = ma_device_get_state(&synth->device);
+    ma_device_state device_state = synth->headless ? ma_device_state_uninitialized : ma_device_get_state(&synth->device);
 
     return (QSynthStat){
         .frame_per_read = AUDIO_FRAME_PER_READ,
         .latency_ms = (int)synth->latency_ms,
-        .max_voice = MAX_VOICE_ACTIVE,
+        .max_voice = synth->voice_n,
         .recent_sample_size = RECENT_SAMPLE_SIZE,
         .recent_samples = synth->recent_samples,
         .sample_processed = synth->samples_played,
@@ -462,14 +1359,29 @@ void synth_print_stat(Synthesizer *synth)
     }
 
     printf("=== QSynth Statistics ===\n");
-    printf("Voices Active: %d\n", MAX_VOICE_ACTIVE);
-    printf("Master Volume: %.2f\n", synth->master_volume);
+    printf("Voices Active: %d / %d\n", synth->voice_active, synth->voice_n);
+    printf("Master Volume: %.2f\n", atomic_load(&synth->master_volume));
     printf("Samples Played: %d\n", synth->samples_played);
     printf("Latency: %dms\n", (int)synth->latency_ms);
+    if (synth->dsp_pool)
+        printf("DSP Workers: %d\n", synth->dsp_pool->worker_n);
+    if (synth->kernels)
+        printf("DSP Kernels: %s\n", synth->kernels->name);
+    printf("Sample Precision: %s\n", QSYNTH_FLOAT32 ? "float32" : "float64");
     printf("=========================\n");
 }
 
 int synth_play_note(Synthesizer *synth, InstrumentType instrument, NoteControlMode control_mode, NoteCfg *cfg)
+{
+    return synth_schedule_note(synth, 0, instrument, control_mode, cfg);
+}
+
+void synth_end_note(Synthesizer *synth, int note_id)
+{
+    synth_schedule_note_off(synth, 0, note_id);
+}
+
+int synth_schedule_note(Synthesizer *synth, uint64_t frame_time, InstrumentType instrument, NoteControlMode control_mode, NoteCfg *cfg)
 {
     if (!synth)
     {
@@ -477,51 +1389,118 @@ int synth_play_note(Synthesizer *synth, InstrumentType instrument, NoteControlMo
         return -1;
     }
 
-    if (cfg->midi_note < 0 || cfg->midi_note > 127)
+    if (cfg->midi_note < 0 || cfg->midi_note > 127 || cfg->channel < 0 || cfg->channel >= MIDI_CHANNELS)
     {
         set_error(QSYNTH_ERROR_NOTECFG);
         return -1;
     }
-    // find free voice
-    for (int i = 0; i < MAX_VOICE_ACTIVE; i++)
+
+    const InstrumentSignature *sig = instrument_get_signature(instrument);
+    if (!sig)
     {
-        if (!synth->voices[i].active)
-        {
-            double frequency = midi_to_frequency(cfg->midi_note);
-            const InstrumentSignature *sig = instrument_get_signature(instrument);
+        printf("cannot find instrument (%d)\n", instrument);
+        set_error(QSYNTH_ERROR_NOTECFG);
+        return -1;
+    }
 
-            if (!sig)
-            {
-                printf("cannot find instrument (%d)\n", instrument);
-                set_error(QSYNTH_ERROR_NOTECFG);
-                return -1;
-            }
+    // the voice is picked by the render side, the caller gets a handle to end the note with
+    // handles come from a running counter and are not reused until it wraps after 2^31 notes
+    SynthCommand cmd = {.type = SYNTH_CMD_NOTE_ON, .frame_time = frame_time};
+    cmd.note_on.note_id = atomic_fetch_add_explicit(&synth->next_note_id, 1, memory_order_relaxed) & INT32_MAX;
+    cmd.note_on.tone = &sig->tone;
+    cmd.note_on.frequency = midi_to_frequency(cfg->midi_note);
+    cmd.note_on.control_mode = control_mode;
+    cmd.note_on.cfg = *cfg;
+
+    if (!synth_push_scheduled(synth, &cmd))
+        return -1;
 
-            Voice *voice = &synth->voices[i];
-            voice_init(voice);
+    return cmd.note_on.note_id;
+}
 
-            voice->duration_ms = cfg->duration_ms;
-            voice->tone = &sig->tone;
-            voice->frequency = frequency;
-            voice->amplitude = cfg->amplitude;
-            voice->pan = cfg->pan;
-            voice->control_mode = control_mode;
+bool synth_schedule_note_off(Synthesizer *synth, uint64_t frame_time, int note_id)
+{
+    if (!synth)
+    {
+        set_error(QSYNTH_ERROR_UNINIT);
+        return false;
+    }
 
-            voice_start(voice, synth->device.sampleRate);
+    SynthCommand cmd = {.type = SYNTH_CMD_NOTE_OFF, .frame_time = frame_time};
+    cmd.note_off.note_id = note_id;
+    return synth_push_scheduled(synth, &cmd);
+}
 
-            printf("Started voice %d: note=%d, freq=%.2f, amp=%.2f\n", i, cfg->midi_note, frequency, cfg->amplitude);
-            return i;
-        }
+void synth_end_note_by_key(Synthesizer *synth, int channel, int midi_note)
+{
+    if (!synth)
+    {
+        set_error(QSYNTH_ERROR_UNINIT);
+        return;
     }
 
-    printf("voice unavailable, used up %d voices\n", MAX_VOICE_ACTIVE);
-    set_error(QSYNTH_ERROR_VOICE_UNAVAILABLE);
-    return -1;
+    if (midi_note < 0 || midi_note > 127 || channel < 0 || channel >= MIDI_CHANNELS)
+    {
+        set_error(QSYNTH_ERROR_NOTECFG);
+        return;
+    }
+
+    SynthCommand cmd = {.type = SYNTH_CMD_NOTE_OFF_KEY};
+    cmd.note_off.channel = channel;
+    cmd.note_off.midi_note = midi_note;
+    synth_push_command(synth, &cmd);
+}
+
+uint64_t synth_get_frame_time(Synthesizer *synth)
+{
+    if (!synth)
+    {
+        set_error(QSYNTH_ERROR_UNINIT);
+        return 0;
+    }
+
+    return atomic_load_explicit(&synth->frame_clock, memory_order_relaxed);
 }
 
-void synth_end_note(Synthesizer *synth, int voice_id)
+// queue a pedal for position idx and mirror it, caller holds ctrl_lock
+static int synth_pedalchain_add_locked(Synthesizer *synth, int idx, PedalType pedal)
 {
-    voice_end(&synth->voices[voice_id]);
+    if (synth->ctrl_pedal_n >= PEDALCHAIN_MAX_PEDALS)
+    {
+        printf("WARNING: pedal chain is full (%d pedals)\n", PEDALCHAIN_MAX_PEDALS);
+        return -1;
+    }
+
+    // allocate here, the render side only links the node
+    Pedal *new_pedal = NULL;
+    PedalNode *node = malloc(sizeof(PedalNode));
+    if (!node || !pedal_create(&new_pedal, pedal, synth->sample_rate))
+    {
+        free(node);
+        set_error(QSYNTH_ERROR_MEMALLOC);
+        return -1;
+    }
+    node->pedal = new_pedal;
+    node->next = NULL;
+
+    SynthCommand cmd = {.type = SYNTH_CMD_PEDAL_INSERT};
+    cmd.pedal.idx = idx;
+    cmd.pedal.node = node;
+
+    if (!synth_push_command(synth, &cmd))
+    {
+        synth_free_pedal_node(node);
+        return -1;
+    }
+
+    memmove(&synth->ctrl_pedals[idx + 1], &synth->ctrl_pedals[idx],
+            (synth->ctrl_pedal_n - idx) * sizeof(PedalShadow));
+    synth->ctrl_pedals[idx].type = pedal;
+    synth->ctrl_pedals[idx].bypass = false;
+    memcpy(synth->ctrl_pedals[idx].params, new_pedal->params, sizeof(new_pedal->params));
+    synth->ctrl_pedal_n++;
+
+    return idx;
 }
 
 int synth_pedalchain_append(Synthesizer *synth, PedalType pedal)
@@ -532,13 +1511,14 @@ int synth_pedalchain_append(Synthesizer *synth, PedalType pedal)
         return -1;
     }
 
-    Pedal *new_pedal = NULL;
-    pedal_create(&new_pedal, pedal, synth->device.sampleRate);
-    int pedal_id = pedal_chain_append(synth->pedalchain, new_pedal);
+    pthread_mutex_lock(&synth->ctrl_lock);
+    synth_collect_retired(synth);
+    int pedal_id = synth_pedalchain_add_locked(synth, synth->ctrl_pedal_n, pedal);
+    pthread_mutex_unlock(&synth->ctrl_lock);
+
     if (pedal_id == -1)
     {
         printf("WARNING: pedal append failed!\n");
-        pedal_destroy(new_pedal);
         return -1;
     }
     printf("pedal append %d\n", pedal);
@@ -554,15 +1534,16 @@ int synth_pedalchain_insert(Synthesizer *synth, int idx, PedalType pedal)
         return -1;
     }
 
-    Pedal *new_pedal = NULL;
-    pedal_create(&new_pedal, pedal, synth->device.sampleRate);
-
-    bool ret = pedal_chain_insert(synth->pedalchain, idx, new_pedal);
+    pthread_mutex_lock(&synth->ctrl_lock);
+    synth_collect_retired(synth);
+    int ret = -1;
+    if (idx >= 0 && idx <= synth->ctrl_pedal_n)
+        ret = synth_pedalchain_add_locked(synth, idx, pedal);
+    pthread_mutex_unlock(&synth->ctrl_lock);
 
-    if (!ret)
+    if (ret == -1)
     {
         printf("WARNING: pedal insert failed!\n");
-        pedal_destroy(new_pedal);
         return -1;
     }
     return idx;
@@ -576,7 +1557,24 @@ bool synth_pedalchain_swap(Synthesizer *synth, int idx1, int idx2)
         return -1;
     }
 
-    bool ret = pedal_chain_swap(synth->pedalchain, idx1, idx2);
+    bool ret = false;
+    pthread_mutex_lock(&synth->ctrl_lock);
+    if (idx1 != idx2 && idx1 >= 0 && idx1 < synth->ctrl_pedal_n && idx2 >= 0 && idx2 < synth->ctrl_pedal_n)
+    {
+        SynthCommand cmd = {.type = SYNTH_CMD_PEDAL_SWAP};
+        cmd.pedal.idx = idx1;
+        cmd.pedal.idx2 = idx2;
+
+        ret = synth_push_command(synth, &cmd);
+        if (ret)
+        {
+            PedalShadow temp = synth->ctrl_pedals[idx1];
+            synth->ctrl_pedals[idx1] = synth->ctrl_pedals[idx2];
+            synth->ctrl_pedals[idx2] = temp;
+        }
+    }
+    pthread_mutex_unlock(&synth->ctrl_lock);
+
     if (!ret)
         printf("WARNING: pedal swap failed!\n");
 
@@ -591,7 +1589,24 @@ bool synth_pedalchain_remove(Synthesizer *synth, int idx)
         return -1;
     }
 
-    bool ret = pedal_chain_remove(synth->pedalchain, idx);
+    bool ret = false;
+    pthread_mutex_lock(&synth->ctrl_lock);
+    synth_collect_retired(synth);
+    if (idx >= 0 && idx < synth->ctrl_pedal_n)
+    {
+        SynthCommand cmd = {.type = SYNTH_CMD_PEDAL_REMOVE};
+        cmd.pedal.idx = idx;
+
+        ret = synth_push_command(synth, &cmd);
+        if (ret)
+        {
+            memmove(&synth->ctrl_pedals[idx], &synth->ctrl_pedals[idx + 1],
+                    (synth->ctrl_pedal_n - idx - 1) * sizeof(PedalShadow));
+            synth->ctrl_pedal_n--;
+        }
+    }
+    pthread_mutex_unlock(&synth->ctrl_lock);
+
     if (!ret)
         printf("WARNING: pedal (%d) remove failed!\n", idx);
 
@@ -608,7 +1623,11 @@ size_t synth_pedalchain_size(Synthesizer *synth)
         return -1;
     }
 
-    return pedal_chain_size(synth->pedalchain);
+    pthread_mutex_lock(&synth->ctrl_lock);
+    size_t size = (size_t)synth->ctrl_pedal_n;
+    pthread_mutex_unlock(&synth->ctrl_lock);
+
+    return size;
 }
 
 void synth_pedalchain_print(Synthesizer *synth)
@@ -619,7 +1638,13 @@ void synth_pedalchain_print(Synthesizer *synth)
         printf("pedalchain print failed due to uninitialized\n");
         return;
     }
-    pedal_chain_print(synth->pedalchain);
+
+    pthread_mutex_lock(&synth->ctrl_lock);
+    printf("Chain (%d pedals): ", synth->ctrl_pedal_n);
+    for (int i = 0; i < synth->ctrl_pedal_n; i++)
+        printf("[%d]->", i);
+    printf("NULL\n");
+    pthread_mutex_unlock(&synth->ctrl_lock);
 }
 
 PedalInfo synth_pedal_info(PedalType pedal)
@@ -652,16 +1677,20 @@ PedalInfo synth_pedalchain_get(Synthesizer *synth, int idx)
         return (PedalInfo){0};
     }
 
-    PedalNode *node = pedal_chain_get(synth->pedalchain, idx);
-    if (!node)
+    pthread_mutex_lock(&synth->ctrl_lock);
+    if (idx < 0 || idx >= synth->ctrl_pedal_n)
     {
+        pthread_mutex_unlock(&synth->ctrl_lock);
         return (PedalInfo){0};
     }
 
-    PedalInfo info = synth_pedal_info(node->pedal->type);
-    
+    PedalShadow pedal = synth->ctrl_pedals[idx];
+    pthread_mutex_unlock(&synth->ctrl_lock);
+
+    PedalInfo info = synth_pedal_info(pedal.type);
+
     for (int i = 0; i < info.param_count; ++i) {
-        info.params[i].current_value = node->pedal->params[i];
+        info.params[i].current_value = pedal.params[i];
     }
     return info;
 }
@@ -675,15 +1704,22 @@ void synth_pedalchain_set(Synthesizer *synth, int idx, int param_idx, double new
         return;
     }
 
-    PedalNode *target = pedal_chain_get(synth->pedalchain, idx);
-
-    if (!target)
+    pthread_mutex_lock(&synth->ctrl_lock);
+    if (idx < 0 || idx >= synth->ctrl_pedal_n || param_idx < 0 || param_idx >= PEDAL_MAX_PARAMS)
     {
+        pthread_mutex_unlock(&synth->ctrl_lock);
         printf("set pedalchain parameter failed due to index out of range\n");
         return;
     }
 
-    pedal_set_param(target->pedal, param_idx, new_param);
+    SynthCommand cmd = {.type = SYNTH_CMD_PEDAL_SET_PARAM};
+    cmd.pedal.idx = idx;
+    cmd.pedal.param_idx = param_idx;
+    cmd.pedal.value = new_param;
+
+    if (synth_push_command(synth, &cmd))
+        synth->ctrl_pedals[idx].params[param_idx] = new_param;
+    pthread_mutex_unlock(&synth->ctrl_lock);
 }
 
 void synth_pedalchain_set_bypass(Synthesizer *synth, int idx, bool bypass)
@@ -695,15 +1731,22 @@ void synth_pedalchain_set_bypass(Synthesizer *synth, int idx, bool bypass)
         return;
     }
 
-    PedalNode *target = pedal_chain_get(synth->pedalchain, idx);
-
-    if (!target)
+    pthread_mutex_lock(&synth->ctrl_lock);
+    if (idx < 0 || idx >= synth->ctrl_pedal_n)
     {
+        pthread_mutex_unlock(&synth->ctrl_lock);
         printf("set pedalchain parameter failed due to index out of range\n");
         return;
     }
 
-    target->pedal->bypass = bypass;
+    SynthCommand cmd = {.type = SYNTH_CMD_PEDAL_SET_BYPASS};
+    cmd.pedal.idx = idx;
+    cmd.pedal.bypass = bypass;
+
+    if (synth_push_command(synth, &cmd))
+        synth->ctrl_pedals[idx].bypass = bypass;
+    pthread_mutex_unlock(&synth->ctrl_lock);
+
     printf("set pedal bypass mode to: %s\n", bypass ? "bypass" : "active");
 }
 
@@ -716,15 +1759,18 @@ bool synth_pedalchain_is_bypass(Synthesizer *synth, int idx)
         return false;
     }
 
-    PedalNode *target = pedal_chain_get(synth->pedalchain, idx);
+    pthread_mutex_lock(&synth->ctrl_lock);
+    bool found = idx >= 0 && idx < synth->ctrl_pedal_n;
+    bool ret = found && synth->ctrl_pedals[idx].bypass;
+    pthread_mutex_unlock(&synth->ctrl_lock);
 
-    if (!target)
+    if (!found)
     {
         printf("set pedalchain parameter failed due to index out of range\n");
         return false;
     }
 
-    return target->pedal->bypass;
+    return ret;
 }
 
 double synth_set_master_volume(Synthesizer *synth, double volume)
@@ -739,12 +1785,16 @@ double synth_set_master_volume(Synthesizer *synth, double volume)
     {
         printf("volume can only be set in range 0-1\n");
         set_error(QSYNTH_ERROR_NOTECFG);
-        return synth->master_volume;
+        return atomic_load(&synth->master_volume);
     }
 
+    SynthCommand cmd = {.type = SYNTH_CMD_MASTER_VOLUME};
+    cmd.master_volume.volume = volume;
+    if (!synth_push_command(synth, &cmd))
+        return atomic_load(&synth->master_volume);
+
     printf("set master volume to be: %f\n", volume);
-    synth->master_volume = volume;
-    return synth->master_volume;
+    return volume;
 }
 
 // ERROR HANDLING FUNCTIONS
@@ -767,6 +1817,8 @@ const char *synth_get_error_string(QSynthError error)
         return "Synthesizer not initialized";
     case QSYNTH_ERROR_UNSUPPORT:
         return "Supported function";
+    case QSYNTH_ERROR_QUEUE_FULL:
+        return "Control command queue full";
     default:
         return "Unknown error";
     }
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #include "qsynth.h"
 #include "stream.h"
 #include "voice.h"
+#include "dsp_kernels.h"
+#include "dsp_pool.h"
+#include "command_queue.h"
+#include "event_heap.h"
 
 #include "../audio/miniaudio.h"
 #include "../assets/pedal_core.h"
@@ -13,6 +18,13 @@
 #define RECENT_SAMPLE_SIZE 1024 // have to be power of 2
 #define RECENT_SAMPLE_MASK 1023 // always equal to RECENT_SAMPLE_SIZE-1
 
+// one live note in the handle map, handle -1 marks a free entry
+typedef struct
+{
+    int handle;
+    int voice;
+} NoteHandleEntry;
+
 #ifdef _WIN32
 #include <windows.h>
 #define SLEEP_MS(ms) Sleep(ms)
@@ -21,35 +33,92 @@
 #define SLEEP_MS(ms) usleep((ms) * 1000)
 #endif
 
+// control side copy of a chained pedal
+typedef struct
+{
+    PedalType type;
+    bool bypass;
+    double params[PEDAL_MAX_PARAMS];
+} PedalShadow;
+
 struct Synthesizer
 {
     // Audio system
     ma_device device;
 
-    // Voice management
-    Voice voices[MAX_VOICE_ACTIVE];
+    // Voice management, the pool is preallocated at init
+    Voice *voices;
+    int voice_n;
+    QSynthStealPolicy steal_policy;
+    uint32_t noise_seed; // QSynthCfg.noise_seed, mixed with the note id into the seed of each voice
+    int *free_voices;   // stack of idle voices, render side only
+    int free_n;
+    int *active_voices; // voices bound to a note, oldest first, render side only
+    int active_n;
+
+    // note lookup, render side only
+    NoteHandleEntry *handle_map; // handle of every voice in active_voices, open addressing at twice the polyphony
+    int handle_mask;
+    int key_handles[MIDI_CHANNELS][128];   // newest note handle per key, -1 if none
 
     // Pedal management
     PedalChain *pedalchain;
 
     // Global settings
-    double master_volume;
+    _Atomic double master_volume; // written by the render side, read by the threaded mode callback
+    QSynthRenderMode render_mode;
+    bool headless;
 
     // State
     int samples_played;
-    bool voice_dp_generator_running;
-    bool pedal_dp_generator_running;
-    bool voice_mix_generator_running;
+    atomic_bool voice_dp_generator_running;
+    atomic_bool pedal_dp_generator_running;
+    atomic_bool voice_mix_generator_running;
     uint64_t latency_ms;
     int voice_active;
 
     int16_t recent_samples[RECENT_SAMPLE_SIZE];
     uint32_t recent_samples_writeptr;
 
+    // pull mode render jobs, one per voice group and one per voice that fits no group
+    DspPool *dsp_pool;
+    const DspKernels *kernels; // picked for the running CPU at init
+    int render_frames;
+    float *voice_block;        // RENDER_BLOCK_SIZE frames per voice
+    VoiceGroup *voice_groups;  // rebuilt every span, at most one per voice
+    int group_n;
+    int *solo_voices;
+    int solo_n;
+    qsample *voice_stream_bufs; // threaded mode voice streams, VOICE_BUFFER_SIZE per voice, kept out of the Voice pool
+
+    // pull mode mix bus
+    qsample mix_left[RENDER_BLOCK_SIZE];
+    qsample mix_right[RENDER_BLOCK_SIZE];
+
     // intermidiate streamers
-    double voice_mix_buf[VOICE_MIX_BUFFER_SIZE];
+    qsample voice_mix_buf[VOICE_MIX_BUFFER_SIZE];
     AudioStreamBuffer voice_mix_streamer;
 
+    // control -> render commands, drained at the start of every render block
+    CommandQueue commands;
+    CommandQueue retired; // render -> control, pedal nodes unlinked from the chain
+    SynthCommand deferred_cmd; // render side, a pedal remove held back while retired is full
+    bool has_deferred_cmd;     // deferred_cmd runs before any later command
+    atomic_int next_note_id;
+
+    // scheduled events, render side only
+    EventHeap events;
+    _Atomic uint64_t frame_clock; // frames rendered so far, only the render side advances it
+    atomic_int events_pending;    // scheduled commands queued or in the heap, at most EVENT_QUEUE_SIZE
+
+    // control side view of the pedal chain, serializes pedal edits between control threads
+    // the render thread never touches it
+    pthread_mutex_t ctrl_lock;
+    PedalShadow ctrl_pedals[PEDALCHAIN_MAX_PEDALS];
+    int ctrl_pedal_n;
+
     // static pre-computed data
+    double sample_rate;
     double delta_time;
+    BiquadCache filter_cache; // filled with the instrument filters at init, render side only after that
 };
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dsp_kernels.h"
+
+#define MIX_LANES ((int)(64 / sizeof(qsample))) // one AVX-512 vector of samples
+
+typedef qsample mix_qs __attribute__((vector_size(MIX_LANES * sizeof(qsample))));
+typedef float mix_f32 __attribute__((vector_size(MIX_LANES * sizeof(float))));
+
+static inline __attribute__((always_inline)) void mix_pan_impl(qsample *left, qsample *right, const float *block,
+                                                               qsample left_gain, qsample right_gain, int frames)
+{
+    int i = 0;
+
+    for (; i + MIX_LANES <= frames; i += MIX_LANES)
+    {
+        mix_f32 in;
+        mix_qs l, r;
+        memcpy(&in, &block[i], sizeof(in));
+        memcpy(&l, &left[i], sizeof(l));
+        memcpy(&r, &right[i], sizeof(r));
+
+        mix_qs sample = __builtin_convertvector(in, mix_qs);
+        l += sample * left_gain;
+        r += sample * right_gain;
+
+        memcpy(&left[i], &l, sizeof(l));
+        memcpy(&right[i], &r, sizeof(r));
+    }
+
+    for (; i < frames; i++)
+    {
+        left[i] += block[i] * left_gain;
+        right[i] += block[i] * right_gain;
+    }
+}
+
+#define DSP_MIX_PAN_DEFINE(suffix, target)                                                                         \
+    target void mix_pan_##suffix(qsample *left, qsample *right, const float *block, qsample left_gain,            \
+                                 qsample right_gain, int frames)                                                   \
+    {                                                                                                              \
+        mix_pan_impl(left, right, block, left_gain, right_gain, frames);                                          \
+    }
+DSP_KERNEL_VARIANTS(DSP_MIX_PAN_DEFINE)
+
+// linear pan law like mix_pan, the gains come from the pan of each frame
+static inline __attribute__((always_inline)) void mix_pan_buffer_impl(qsample *left, qsample *right,
+                                                                      const float *block, const qsample *pan,
+                                                                      int frames)
+{
+    int i = 0;
+
+    for (; i + MIX_LANES <= frames; i += MIX_LANES)
+    {
+        mix_f32 in;
+        mix_qs p, l, r;
+        memcpy(&in, &block[i], sizeof(in));
+        memcpy(&p, &pan[i], sizeof(p));
+        memcpy(&l, &left[i], sizeof(l));
+        memcpy(&r, &right[i], sizeof(r));
+
+        mix_qs sample = __builtin_convertvector(in, mix_qs);
+        mix_qs panned = sample * p;
+        l += sample - panned;
+        r += panned;
+
+        memcpy(&left[i], &l, sizeof(l));
+        memcpy(&right[i], &r, sizeof(r));
+    }
+
+    for (; i < frames; i++)
+    {
+        qsample panned = block[i] * pan[i];
+        left[i] += block[i] - panned;
+        right[i] += panned;
+    }
+}
+
+#define DSP_MIX_PAN_BUFFER_DEFINE(suffix, target)                                                                  \
+    target void mix_pan_buffer_##suffix(qsample *left, qsample *right, const float *block, const qsample *pan,    \
+                                        int frames)                                                                \
+    {                                                                                                              \
+        mix_pan_buffer_impl(left, right, block, pan, frames);                                                     \
+    }
+DSP_KERNEL_VARIANTS(DSP_MIX_PAN_BUFFER_DEFINE)
+
+static const DspKernels dsp_kernels[DSP_ISA_COUNT] = {
+    [DSP_ISA_GENERIC] = {
+        .isa = DSP_ISA_GENERIC,
+        .name = "generic",
+        .voice_group_render = voice_group_render_generic,
+        .mix_pan = mix_pan_generic,
+        .mix_pan_buffer = mix_pan_buffer_generic,
+    },
+    [DSP_ISA_AVX2] = {
+        .isa = DSP_ISA_AVX2,
+        .name = "avx2",
+        .voice_group_render = voice_group_render_avx2,
+        .mix_pan = mix_pan_avx2,
+        .mix_pan_buffer = mix_pan_buffer_avx2,
+    },
+    [DSP_ISA_AVX512] = {
+        .isa = DSP_ISA_AVX512,
+        .name = "avx512",
+        .voice_group_render = voice_group_render_avx512,
+        .mix_pan = mix_pan_avx512,
+        .mix_pan_buffer = mix_pan_buffer_avx512,
+    },
+};
+
+DspIsa dsp_isa_detect(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // libgcc also checks that the OS saves the wide registers
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return DSP_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return DSP_ISA_AVX2;
+#endif
+    return DSP_ISA_GENERIC;
+}
+
+const char *dsp_isa_name(DspIsa isa)
+{
+    return isa >= 0 && isa < DSP_ISA_COUNT ? dsp_kernels[isa].name : "unknown";
+}
+
+const DspKernels *dsp_kernels_select(void)
+{
+    DspIsa detected = dsp_isa_detect();
+    DspIsa isa = detected;
+
+    const char *env = getenv(DSP_ISA_ENV);
+    if (env && *env)
+    {
+        DspIsa requested;
+        if (strcmp(env, "generic") == 0 || strcmp(env, "sse2") == 0)
+            requested = DSP_ISA_GENERIC;
+        else if (strcmp(env, "avx2") == 0)
+            requested = DSP_ISA_AVX2;
+        else if (strcmp(env, "avx512") == 0)
+            requested = DSP_ISA_AVX512;
+        else
+            requested = DSP_ISA_COUNT;
+
+        if (requested == DSP_ISA_COUNT)
+            printf("%s=%s not recognized, using %s\n", DSP_ISA_ENV, env, dsp_isa_name(detected));
+        else if (requested > detected)
+            printf("%s=%s not supported by this CPU, using %s\n", DSP_ISA_ENV, env, dsp_isa_name(detected));
+        else
+            isa = requested;
+    }
+
+    return &dsp_kernels[isa];
+}
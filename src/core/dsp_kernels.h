@@ -0,0 +1,68 @@
+#pragma once
+
+#include "voice_bank.h"
+
+// instruction set levels the DSP kernels are compiled for, every level includes the ones below
+typedef enum
+{
+    DSP_ISA_GENERIC = 0, // whatever the build targets, SSE2 for the stock x86-64 build
+    DSP_ISA_AVX2,        // AVX2 + FMA
+    DSP_ISA_AVX512,      // AVX-512F
+    DSP_ISA_COUNT,
+} DspIsa;
+
+// Each kernel is compiled once per level with a target attribute, the build itself stays baseline
+#if defined(__x86_64__) || defined(__i386__)
+#define DSP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define DSP_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define DSP_TARGET_AVX2
+#define DSP_TARGET_AVX512
+#endif
+
+// define a kernel for every level, DEFINE(suffix, target_attribute)
+#define DSP_KERNEL_VARIANTS(DEFINE) \
+    DEFINE(generic, )               \
+    DEFINE(avx2, DSP_TARGET_AVX2)   \
+    DEFINE(avx512, DSP_TARGET_AVX512)
+
+#define DSP_ISA_ENV "QSYNTH_ISA" // override for A/B tests: generic, sse2, avx2 or avx512, capped at what the CPU has
+
+typedef void (*VoiceGroupRenderFn)(const VoiceGroup *group, Voice *voices, float *voice_block, int frames);
+typedef void (*MixPanFn)(qsample *left, qsample *right, const float *block, qsample left_gain, qsample right_gain,
+                         int frames);
+typedef void (*MixPanBufferFn)(qsample *left, qsample *right, const float *block, const qsample *pan, int frames);
+
+typedef struct
+{
+    DspIsa isa;
+    const char *name;
+    VoiceGroupRenderFn voice_group_render; // voices of the same plan shape side by side, one per lane
+    MixPanFn mix_pan;                      // add a mono voice block to the stereo bus
+    MixPanBufferFn mix_pan_buffer;         // same with a pan per frame, pan modulated voices
+} DspKernels;
+
+/**
+ * Detect the instruction sets of the running CPU
+ * @return Highest level supported by the CPU and the OS
+ */
+DspIsa dsp_isa_detect(void);
+
+const char *dsp_isa_name(DspIsa isa);
+
+/**
+ * Pick the kernels for the running CPU, DSP_ISA_ENV overrides the detected level
+ * @return Kernel table, valid for the lifetime of the process
+ */
+const DspKernels *dsp_kernels_select(void);
+
+#define DSP_MIX_PAN_DECLARE(suffix, target)                                                                      \
+    void mix_pan_##suffix(qsample *left, qsample *right, const float *block, qsample left_gain,                 \
+                          qsample right_gain, int frames);
+DSP_KERNEL_VARIANTS(DSP_MIX_PAN_DECLARE)
+
+#define DSP_MIX_PAN_BUFFER_DECLARE(suffix, target)                                                               \
+    void mix_pan_buffer_##suffix(qsample *left, qsample *right, const float *block, const qsample *pan, int frames);
+DSP_KERNEL_VARIANTS(DSP_MIX_PAN_BUFFER_DECLARE)
+
+DSP_KERNEL_VARIANTS(VOICE_GROUP_RENDER_DECLARE)
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dsp_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+struct dsp_worker_args
+{
+    DspPool *pool;
+    int worker_idx;
+};
+
+int dsp_hardware_concurrency(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int n = (int)info.dwNumberOfProcessors;
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n > 0 ? n : 1;
+}
+
+// drain own slice first, then steal from the other slices
+static void dsp_pool_work(DspPool *pool, int worker_idx)
+{
+    for (int k = 0; k < pool->worker_n; k++)
+    {
+        DspJobRange *range = &pool->ranges[(worker_idx + k) % pool->worker_n];
+
+        for (;;)
+        {
+            int job = atomic_fetch_add_explicit(&range->next, 1, memory_order_relaxed);
+            if (job >= range->end)
+                break;
+
+            pool->fn(pool->ctx, job);
+        }
+    }
+}
+
+static bool dsp_pool_done(void *arg)
+{
+    DspPool *pool = (DspPool *)arg;
+    return atomic_load_explicit(&pool->pending, memory_order_acquire) == 0;
+}
+
+static void *dsp_pool_worker(void *arg)
+{
+    struct dsp_worker_args *args = (struct dsp_worker_args *)arg;
+    DspPool *pool = args->pool;
+    int worker_idx = args->worker_idx;
+    free(args);
+
+    unsigned int seen_epoch = 0;
+
+    for (;;)
+    {
+        // dispatches come once per block, catch the next one without a syscall if it is close
+        for (int i = 0; i < WAIT_EVENT_SPIN; i++)
+        {
+            if (atomic_load_explicit(&pool->epoch, memory_order_acquire) != seen_epoch)
+                break;
+            cpu_relax();
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load_explicit(&pool->running, memory_order_relaxed) &&
+               atomic_load_explicit(&pool->epoch, memory_order_acquire) == seen_epoch)
+        {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (!atomic_load_explicit(&pool->running, memory_order_relaxed))
+            break;
+
+        seen_epoch = atomic_load_explicit(&pool->epoch, memory_order_acquire);
+
+        dsp_pool_work(pool, worker_idx);
+
+        if (atomic_fetch_sub(&pool->pending, 1) == 1)
+            wait_event_wake(&pool->done);
+    }
+
+    return NULL;
+}
+
+bool dsp_pool_create(DspPool **pool_ptr, int worker_n)
+{
+    if (!pool_ptr)
+        return false;
+
+    if (worker_n <= 0)
+        worker_n = dsp_hardware_concurrency();
+    if (worker_n > DSP_POOL_MAX_WORKERS)
+        worker_n = DSP_POOL_MAX_WORKERS;
+
+    DspPool *pool = calloc(1, sizeof(DspPool));
+    if (!pool)
+        return false;
+
+    pool->worker_n = 1;
+    atomic_init(&pool->epoch, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->running, true);
+    for (int i = 0; i < DSP_POOL_MAX_WORKERS; i++)
+    {
+        atomic_init(&pool->ranges[i].next, 0);
+        pool->ranges[i].end = 0;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    wait_event_init(&pool->done);
+
+    // worker 0 is the caller of dsp_pool_run, spawn the helpers
+    for (int i = 1; i < worker_n; i++)
+    {
+        struct dsp_worker_args *args = malloc(sizeof(struct dsp_worker_args));
+        if (!args)
+            break;
+
+        args->pool = pool;
+        args->worker_idx = i;
+
+        if (pthread_create(&pool->threads[i], NULL, dsp_pool_worker, args) != 0)
+        {
+            free(args);
+            printf("Failed to create DSP worker thread %d\n", i);
+            break;
+        }
+        pool->worker_n++;
+    }
+
+    *pool_ptr = pool;
+    return true;
+}
+
+void dsp_pool_destroy(DspPool *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->running, false);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->worker_n; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    wait_event_destroy(&pool->done);
+    free(pool);
+}
+
+void dsp_pool_run(DspPool *pool, DspJobFn fn, void *ctx, int job_n)
+{
+    if (job_n <= 0)
+        return;
+
+    // not worth waking anyone up
+    if (pool->worker_n == 1 || job_n == 1)
+    {
+        for (int i = 0; i < job_n; i++)
+            fn(ctx, i);
+        return;
+    }
+
+    pool->fn = fn;
+    pool->ctx = ctx;
+
+    // split the job list into one contiguous slice per worker
+    int per_worker = job_n / pool->worker_n;
+    int remainder = job_n % pool->worker_n;
+    int begin = 0;
+    for (int i = 0; i < pool->worker_n; i++)
+    {
+        int count = per_worker + (i < remainder ? 1 : 0);
+        atomic_store_explicit(&pool->ranges[i].next, begin, memory_order_relaxed);
+        pool->ranges[i].end = begin + count;
+        begin += count;
+    }
+
+    atomic_store_explicit(&pool->pending, pool->worker_n - 1, memory_order_relaxed);
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add_explicit(&pool->epoch, 1, memory_order_release);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    dsp_pool_work(pool, 0);
+
+    // barrier before the caller moves on to mixing
+    wait_event_wait(&pool->done, 0, dsp_pool_done, pool);
+}
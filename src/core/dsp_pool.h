@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "pthread.h"
+#include "wait_event.h"
+
+#define DSP_POOL_MAX_WORKERS 16
+#define DSP_CACHE_LINE 64
+
+// job callback, job_idx in [0, job_n)
+typedef void (*DspJobFn)(void *ctx, int job_idx);
+
+// per worker slice of the job list, other workers steal from it once their own slice runs dry
+typedef struct
+{
+    atomic_int next; // next unclaimed job
+    int end;         // one past the last job of this slice
+    char _pad[DSP_CACHE_LINE - sizeof(atomic_int) - sizeof(int)];
+} DspJobRange;
+
+typedef struct
+{
+    int worker_n; // worker 0 is always the thread calling dsp_pool_run
+    pthread_t threads[DSP_POOL_MAX_WORKERS];
+    DspJobRange ranges[DSP_POOL_MAX_WORKERS];
+
+    // current dispatch
+    DspJobFn fn;
+    void *ctx;
+    atomic_uint epoch;  // bumped once per dispatch
+    atomic_int pending; // helpers that have not reached the barrier yet
+    atomic_bool running;
+
+    // helpers spin briefly, then sleep here between dispatches
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    WaitEvent done; // the last helper to finish wakes the caller
+} DspPool;
+
+/**
+ * Create a worker pool
+ * @param pool_ptr Receives the created pool
+ * @param worker_n Total workers including the calling thread, 0 picks the hardware concurrency
+ * @return true on success
+ */
+bool dsp_pool_create(DspPool **pool_ptr, int worker_n);
+void dsp_pool_destroy(DspPool *pool);
+
+/**
+ * Run job_n jobs across the pool and return once all of them finished (barrier)
+ * The calling thread works on its own slice as worker 0
+ */
+void dsp_pool_run(DspPool *pool, DspJobFn fn, void *ctx, int job_n);
+
+int dsp_hardware_concurrency(void);
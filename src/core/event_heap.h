@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "command_queue.h"
+
+typedef struct
+{
+    SynthCommand cmd;
+    uint32_t seq; // keeps events with the same frame time in submission order
+} SynthEvent;
+
+// Binary min-heap of scheduled commands ordered by frame time, owned by the render side
+typedef struct
+{
+    SynthEvent events[EVENT_QUEUE_SIZE];
+    int size;
+    uint32_t next_seq;
+} EventHeap;
+
+static inline bool event_before(const SynthEvent *a, const SynthEvent *b)
+{
+    if (a->cmd.frame_time != b->cmd.frame_time)
+        return a->cmd.frame_time < b->cmd.frame_time;
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+static inline void event_heap_init(EventHeap *heap)
+{
+    heap->size = 0;
+    heap->next_seq = 0;
+}
+
+/**
+ * Insert a scheduled command
+ * @param heap Heap to insert into
+ * @param cmd Command with frame_time set
+ * @return false if the heap is full
+ */
+static inline bool event_heap_push(EventHeap *heap, const SynthCommand *cmd)
+{
+    if (heap->size >= EVENT_QUEUE_SIZE)
+        return false;
+
+    SynthEvent event = {.cmd = *cmd, .seq = heap->next_seq++};
+
+    // sift up
+    int i = heap->size++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!event_before(&event, &heap->events[parent]))
+            break;
+
+        heap->events[i] = heap->events[parent];
+        i = parent;
+    }
+    heap->events[i] = event;
+    return true;
+}
+
+/**
+ * Frame time of the earliest event
+ * @param heap Heap to check
+ * @return UINT64_MAX if the heap is empty
+ */
+static inline uint64_t event_heap_next_time(const EventHeap *heap)
+{
+    return heap->size > 0 ? heap->events[0].cmd.frame_time : UINT64_MAX;
+}
+
+/**
+ * Remove the earliest event
+ * @param heap Heap to pop from, must not be empty
+ * @param cmd Receives the command
+ */
+static inline void event_heap_pop(EventHeap *heap, SynthCommand *cmd)
+{
+    *cmd = heap->events[0].cmd;
+
+    SynthEvent last = heap->events[--heap->size];
+
+    // sift the last event down from the root
+    int i = 0;
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if (child >= heap->size)
+            break;
+        if (child + 1 < heap->size && event_before(&heap->events[child + 1], &heap->events[child]))
+            child++;
+        if (!event_before(&heap->events[child], &last))
+            break;
+
+        heap->events[i] = heap->events[child];
+        i = child;
+    }
+    heap->events[i] = last;
+}
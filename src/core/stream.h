@@ -2,88 +2,180 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "wait_event.h"
+#include "../utils/sample.h"
+
+#define STREAM_CACHE_LINE 64
 
 // Lock-free ring buffer for audio streaming
 // Safe for single reader + single writer (which is your use case)
+// Positions are free running counters, the producer and consumer side each live on their own cache line
+// and keep a cached copy of the opposite position so the shared one is only touched when the cache runs out
+// Each side can sleep until the other one publishes enough data/space instead of polling
 typedef struct
 {
-    double *buffer;              // Buffer to store double values
-    volatile uint32_t write_pos; // Write position (modified by producer)
-    volatile uint32_t read_pos;  // Read position (modified by consumer)
-    uint32_t size;               // Buffer size (number of double elements)
-    uint32_t mask;               // Size mask for fast modulo (size must be power of 2)
+    // producer side
+    _Atomic uint32_t write_pos; // Write position (modified by producer)
+    uint32_t read_pos_cache;    // Last read position seen by the producer
+    char _pad_producer[STREAM_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    // consumer side
+    _Atomic uint32_t read_pos; // Read position (modified by consumer)
+    uint32_t write_pos_cache;  // Last write position seen by the consumer
+    char _pad_consumer[STREAM_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+    // wait/notify, kept off the hot position lines
+    WaitEvent data_event;  // consumer sleeps here until data is available
+    WaitEvent space_event; // producer sleeps here until space is available
+
+    // read only after init
+    qsample *buffer; // Buffer to store samples
+    uint32_t size;   // Buffer size (number of samples)
+    uint32_t mask;   // Size mask for fast modulo (size must be power of 2)
 } AudioStreamBuffer;
 
 // === PUBLIC INTERFACE ===
 
 /**
- * Initialize the lock-free stream buffer
+ * Drop all buffered data, neither side may be using the stream
+ * @param stream Stream to reset
+ */
+static inline void stream_reset(AudioStreamBuffer *stream)
+{
+    atomic_store(&stream->write_pos, 0);
+    atomic_store(&stream->read_pos, 0);
+    stream->read_pos_cache = 0;
+    stream->write_pos_cache = 0;
+
+    // Zero out the buffer
+    memset(stream->buffer, 0, stream->size * sizeof(qsample));
+}
+
+/**
+ * Initialize the lock-free stream buffer, pair with stream_destroy
  * @param stream Stream structure to initialize
  * @param buffer Pre-allocated buffer array
- * @param size Buffer size in number of double elements (must be power of 2)
+ * @param size Buffer size in number of samples (must be power of 2)
  */
-static inline void stream_init(AudioStreamBuffer *stream, double *buffer, uint32_t size)
+static inline void stream_init(AudioStreamBuffer *stream, qsample *buffer, uint32_t size)
 {
     stream->buffer = buffer;
     stream->size = size;
     stream->mask = size - 1; // For power-of-2 sizes: size-1 gives us the mask
-    stream->write_pos = 0;
-    stream->read_pos = 0;
+    atomic_init(&stream->write_pos, 0);
+    atomic_init(&stream->read_pos, 0);
+    wait_event_init(&stream->data_event);
+    wait_event_init(&stream->space_event);
 
-    // Zero out the buffer
-    for (uint32_t i = 0; i < size; i++)
-    {
-        buffer[i] = 0.0;
-    }
+    stream_reset(stream);
+}
+
+/**
+ * Release the wait/notify resources of the stream
+ * @param stream Stream to destroy
+ */
+static inline void stream_destroy(AudioStreamBuffer *stream)
+{
+    wait_event_destroy(&stream->data_event);
+    wait_event_destroy(&stream->space_event);
 }
 
 /**
- * Write a double value to the stream
+ * Write up to count values to the stream (producer only)
  * @param stream Stream to write to
- * @param value Value to write
- * @return 1 if written successfully, 0 if buffer is full
+ * @param src Values to write
+ * @param count Number of values to write
+ * @return Number of values written, less than count if the buffer is full
  */
-static inline int stream_writeDouble(AudioStreamBuffer *stream, double value)
+static inline uint32_t stream_write_block(AudioStreamBuffer *stream, const qsample *src, uint32_t count)
 {
-    uint32_t current_write = stream->write_pos;
-    uint32_t next_write = (current_write + 1) & stream->mask;
+    uint32_t write = atomic_load_explicit(&stream->write_pos, memory_order_relaxed);
+    uint32_t space = stream->size - (write - stream->read_pos_cache);
 
-    // Check if buffer is full
-    if (next_write == stream->read_pos)
+    if (space < count)
     {
-        return 0; // Buffer full - do nothing
+        stream->read_pos_cache = atomic_load_explicit(&stream->read_pos, memory_order_acquire);
+        space = stream->size - (write - stream->read_pos_cache);
     }
 
-    // Write the value
-    stream->buffer[current_write] = value;
+    if (count > space)
+        count = space;
+    if (count == 0)
+        return 0;
 
-    // Update write position (this must be atomic)
-    stream->write_pos = next_write;
+    // at most two spans, the second one wraps around to the buffer start
+    uint32_t index = write & stream->mask;
+    uint32_t first = stream->size - index;
+    if (first > count)
+        first = count;
 
-    return 1; // Success
+    memcpy(stream->buffer + index, src, first * sizeof(qsample));
+    memcpy(stream->buffer, src + first, (count - first) * sizeof(qsample));
+
+    atomic_store_explicit(&stream->write_pos, write + count, memory_order_release);
+    wait_event_notify(&stream->data_event, write + count);
+    return count;
 }
 
 /**
- * Read a double value from the stream
+ * Read up to count values from the stream (consumer only)
  * @param stream Stream to read from
- * @return Value read, or 0.0 if buffer is empty
+ * @param dst Destination for the values
+ * @param count Number of values to read
+ * @return Number of values read, less than count if the buffer runs empty
  */
-static inline double stream_readDouble(AudioStreamBuffer *stream)
+static inline uint32_t stream_read_block(AudioStreamBuffer *stream, qsample *dst, uint32_t count)
 {
-    uint32_t current_read = stream->read_pos;
+    uint32_t read = atomic_load_explicit(&stream->read_pos, memory_order_relaxed);
+    uint32_t available = stream->write_pos_cache - read;
 
-    // Check if buffer is empty
-    if (current_read == stream->write_pos)
+    if (available < count)
     {
-        return 0.0; // Buffer empty - return silence
+        stream->write_pos_cache = atomic_load_explicit(&stream->write_pos, memory_order_acquire);
+        available = stream->write_pos_cache - read;
     }
 
-    // Read the value
-    double value = stream->buffer[current_read];
+    if (count > available)
+        count = available;
+    if (count == 0)
+        return 0;
 
-    // Update read position (this must be atomic)
-    stream->read_pos = (current_read + 1) & stream->mask;
+    uint32_t index = read & stream->mask;
+    uint32_t first = stream->size - index;
+    if (first > count)
+        first = count;
+
+    memcpy(dst, stream->buffer + index, first * sizeof(qsample));
+    memcpy(dst + first, stream->buffer, (count - first) * sizeof(qsample));
+
+    atomic_store_explicit(&stream->read_pos, read + count, memory_order_release);
+    wait_event_notify(&stream->space_event, read + count);
+    return count;
+}
+
+/**
+ * Write a single sample to the stream
+ * @param stream Stream to write to
+ * @param value Value to write
+ * @return 1 if written successfully, 0 if buffer is full
+ */
+static inline int stream_write_sample(AudioStreamBuffer *stream, qsample value)
+{
+    return (int)stream_write_block(stream, &value, 1);
+}
 
+/**
+ * Read a single sample from the stream
+ * @param stream Stream to read from
+ * @return Value read, or 0.0 if buffer is empty
+ */
+static inline qsample stream_read_sample(AudioStreamBuffer *stream)
+{
+    qsample value = 0.0; // Buffer empty - return silence
+    stream_read_block(stream, &value, 1);
     return value;
 }
 
@@ -96,7 +188,9 @@ static inline double stream_readDouble(AudioStreamBuffer *stream)
  */
 static inline uint32_t stream_available(AudioStreamBuffer *stream)
 {
-    return (stream->write_pos - stream->read_pos) & stream->mask;
+    // read position first, it can never overtake a write position loaded later
+    uint32_t read = atomic_load_explicit(&stream->read_pos, memory_order_acquire);
+    return atomic_load_explicit(&stream->write_pos, memory_order_acquire) - read;
 }
 
 /**
@@ -106,7 +200,7 @@ static inline uint32_t stream_available(AudioStreamBuffer *stream)
  */
 static inline uint32_t stream_space(AudioStreamBuffer *stream)
 {
-    return (stream->read_pos - stream->write_pos - 1) & stream->mask;
+    return stream->size - stream_available(stream);
 }
 
 /**
@@ -116,7 +210,7 @@ static inline uint32_t stream_space(AudioStreamBuffer *stream)
  */
 static inline bool stream_isEmpty(AudioStreamBuffer *stream)
 {
-    return stream->read_pos == stream->write_pos;
+    return stream_available(stream) == 0;
 }
 
 /**
@@ -126,7 +220,7 @@ static inline bool stream_isEmpty(AudioStreamBuffer *stream)
  */
 static inline bool stream_isFull(AudioStreamBuffer *stream)
 {
-    return ((stream->write_pos + 1) & stream->mask) == stream->read_pos;
+    return stream_available(stream) == stream->size;
 }
 
 /**
@@ -137,5 +231,65 @@ static inline bool stream_isFull(AudioStreamBuffer *stream)
 static inline double stream_fillRatio(AudioStreamBuffer *stream)
 {
     uint32_t available = stream_available(stream);
-    return (double)available / (double)(stream->size - 1);
+    return (double)available / (double)stream->size;
+}
+
+// === WAIT/NOTIFY ===
+
+struct stream_wait_ctx
+{
+    AudioStreamBuffer *stream;
+    uint32_t count;
+    WaitCond abort; // optional, stop waiting once it holds
+    void *abort_ctx;
+};
+
+static inline bool stream_wait_available_cond(void *arg)
+{
+    struct stream_wait_ctx *ctx = (struct stream_wait_ctx *)arg;
+    return stream_available(ctx->stream) >= ctx->count || (ctx->abort && ctx->abort(ctx->abort_ctx));
+}
+
+static inline bool stream_wait_space_cond(void *arg)
+{
+    struct stream_wait_ctx *ctx = (struct stream_wait_ctx *)arg;
+    return stream_space(ctx->stream) >= ctx->count || (ctx->abort && ctx->abort(ctx->abort_ctx));
+}
+
+/**
+ * Block until count elements can be read (consumer only)
+ * @param stream Stream to wait on
+ * @param count Number of elements needed
+ * @param abort Optional condition that ends the wait early, pair with stream_wake
+ * @param abort_ctx Context passed to abort
+ */
+static inline void stream_wait_available(AudioStreamBuffer *stream, uint32_t count, WaitCond abort, void *abort_ctx)
+{
+    struct stream_wait_ctx ctx = {stream, count, abort, abort_ctx};
+    uint32_t target = atomic_load_explicit(&stream->read_pos, memory_order_relaxed) + count;
+    wait_event_wait(&stream->data_event, target, stream_wait_available_cond, &ctx);
+}
+
+/**
+ * Block until count elements can be written (producer only)
+ * @param stream Stream to wait on
+ * @param count Number of free elements needed
+ * @param abort Optional condition that ends the wait early, pair with stream_wake
+ * @param abort_ctx Context passed to abort
+ */
+static inline void stream_wait_space(AudioStreamBuffer *stream, uint32_t count, WaitCond abort, void *abort_ctx)
+{
+    struct stream_wait_ctx ctx = {stream, count, abort, abort_ctx};
+    uint32_t target = atomic_load_explicit(&stream->write_pos, memory_order_relaxed) + count - stream->size;
+    wait_event_wait(&stream->space_event, target, stream_wait_space_cond, &ctx);
+}
+
+/**
+ * Wake both sides so they re-evaluate their abort condition
+ * @param stream Stream to wake
+ */
+static inline void stream_wake(AudioStreamBuffer *stream)
+{
+    wait_event_wake(&stream->data_event);
+    wait_event_wake(&stream->space_event);
 }
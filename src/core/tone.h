@@ -4,6 +4,7 @@
 #include "qsynth.h"
 #include "../envelope/adsr.h"
 #include "../filters/biquad.h"
+#include "../modulation/modulation.h"
 
 #define TONE_MIX_LEVEL_DEFAULT (1 / MAX_TONE_LAYERS)
 
@@ -16,4 +17,5 @@ typedef struct
 
     FilterCfg filter_opt;           // filter options
     EnvelopeCfg envelope_opt;       // envelop duration control options
+    ModCfg mod;                     // LFOs and modulation envelope routed to pitch/cutoff/amp/pan, none by default
 } Tone;
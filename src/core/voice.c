@@ -4,12 +4,21 @@
 #include <string.h>
 
 #include "voice.h"
+#include "voice_kernels.h"
 
 #include "../envelope/adsr.h"
+#include "../oscillators/polyblep.h"
+#include "../oscillators/wavetable.h"
+#include "../utils/constant.h"
+#include "../utils/fastmath.h"
 
 void voice_init(Voice *voice)
 {
     voice->active = false;
+    voice->release_pending = false;
+    voice->note_id = -1;
+    voice->noise_seed = 0;
+    voice->filter_coeffs = NULL;
     voice->duration_ms = 0;
     voice->tone = NULL;
     voice->frequency = 0;
@@ -19,20 +28,429 @@ void voice_init(Voice *voice)
     voice->cur_duration = 0;
     voice->voice_is_end = false;
 
-    memset(voice->stream_buf, 0, sizeof(voice->stream_buf));
-    memset(voice->phases, 0, sizeof(voice->phases));
+    memset(voice->layers, 0, sizeof(voice->layers));
+    voice->layer_n = 0;
+    voice->kernel = NULL;
+    memset(&voice->mod, 0, sizeof(voice->mod));
+}
+
+// kernels, one per oscillator, expr is evaluated with phase, phase_inc and table in scope
+#define LAYER_KERNEL(name, expr)                                                \
+    static void name##_render(VoiceLayer *layer, qsample *mix, int frames)      \
+    {                                                                           \
+        uint32_t phase = layer->phase;                                          \
+        uint32_t phase_inc = layer->phase_inc;                                  \
+        const float *table = layer->table;                                      \
+        qsample level = layer->level;                                           \
+        (void)table;                                                            \
+        for (int i = 0; i < frames; i++)                                        \
+        {                                                                       \
+            mix[i] += (qsample)(expr) * level;                                  \
+            phase += phase_inc;                                                 \
+        }                                                                       \
+        layer->phase = phase;                                                   \
+    }                                                                           \
+    static void name##_render_ramp(VoiceLayer *layer, qsample *mix, int frames) \
+    {                                                                           \
+        uint32_t phase = layer->phase;                                          \
+        uint32_t phase_inc = layer->phase_inc;                                  \
+        const uint32_t inc_step = (uint32_t)layer->inc_step;                    \
+        const float *table = layer->table;                                      \
+        qsample level = layer->level;                                           \
+        (void)table;                                                            \
+        for (int i = 0; i < frames; i++)                                        \
+        {                                                                       \
+            mix[i] += (qsample)(expr) * level;                                  \
+            phase += phase_inc;                                                 \
+            phase_inc += inc_step;                                              \
+        }                                                                       \
+        layer->phase = phase;                                                   \
+        layer->phase_inc = phase_inc;                                           \
+    }
+
+LAYER_KERNEL(layer_table, wavetable_read(table, phase))
+LAYER_KERNEL(layer_blep_square, polyblep_square(phase, phase_inc))
+LAYER_KERNEL(layer_blep_sawtooth, polyblep_sawtooth(phase, phase_inc))
+LAYER_KERNEL(layer_blep_triangle, polyblep_triangle(phase, phase_inc))
+
+// noise has no phase, the layer advances its own counter based stream
+static void layer_noise_render(VoiceLayer *layer, qsample *mix, int frames)
+{
+    float block[RENDER_BLOCK_SIZE];
+    qsample level = layer->level;
+
+    noise_render(&layer->noise, block, frames);
+    for (int i = 0; i < frames; i++)
+        mix[i] += (qsample)block[i] * level;
+}
+
+// pitch does not reach noise
+static void layer_noise_render_ramp(VoiceLayer *layer, qsample *mix, int frames)
+{
+    layer_noise_render(layer, mix, frames);
+}
+
+#define LAYER_BIND(layer, layer_kind, name)        \
+    do                                             \
+    {                                              \
+        (layer)->render = name##_render;           \
+        (layer)->render_ramp = name##_render_ramp; \
+        (layer)->kind = layer_kind;                \
+    } while (0)
+
+static NoiseColor layer_noise_color(WaveType type)
+{
+    switch (type)
+    {
+    case WAVE_PINK_NOISE:
+        return NOISE_PINK;
+    case WAVE_BROWN_NOISE:
+        return NOISE_BROWN;
+    default:
+        return NOISE_WHITE;
+    }
+}
+
+// seed is the stream key of noise layers, unique per voice and layer
+static void layer_bind_kernel(VoiceLayer *layer, const Wave *wave, uint32_t seed)
+{
+    if (wave_is_noise(wave))
+    {
+        LAYER_BIND(layer, LAYER_NOISE, layer_noise);
+        noise_init(&layer->noise, layer_noise_color(wave->type), seed);
+    }
+    else if (!wave_is_polyblep(wave))
+        LAYER_BIND(layer, LAYER_TABLE, layer_table);
+    else if (wave->type == WAVE_SQUARE)
+        LAYER_BIND(layer, LAYER_BLEP_SQUARE, layer_blep_square);
+    else if (wave->type == WAVE_SAWTOOTH)
+        LAYER_BIND(layer, LAYER_BLEP_SAWTOOTH, layer_blep_sawtooth);
+    else
+        LAYER_BIND(layer, LAYER_BLEP_TRIANGLE, layer_blep_triangle);
+}
+
+static void voice_filter_block(Voice *voice, qsample *mix, int frames)
+{
+    if (voice->filter.cfg.topology == FILTER_TOPOLOGY_SVF)
+        svf_process_block(&voice->svf, mix, frames);
+    else
+        biquad_process_block(&voice->filter, mix, frames);
+}
+
+// generic path, layer by layer through the mix buffer
+static void voice_kernel_generic(Voice *voice, const qsample *env, float *out, int frames)
+{
+    qsample mix[RENDER_BLOCK_SIZE];
+
+    memset(mix, 0, frames * sizeof(qsample));
+    for (int l = 0; l < voice->layer_n; l++)
+        voice->layers[l].render(&voice->layers[l], mix, frames);
+
+    voice_filter_block(voice, mix, frames);
+
+    for (int i = 0; i < frames; i++)
+        out[i] = (float)(mix[i] * env[i] * (qsample)voice->amplitude);
+}
+
+// building blocks of the fused kernels, expanded per layer slot l, NONE slots expand to nothing
+#define LAYER_LOAD_NONE(l)
+#define LAYER_LOAD_OSC(l)                                \
+    uint32_t phase##l = voice->layers[l].phase;          \
+    const uint32_t phase_inc##l = voice->layers[l].phase_inc; \
+    const qsample level##l = voice->layers[l].level;
+#define LAYER_LOAD_TABLE(l) \
+    LAYER_LOAD_OSC(l)       \
+    const float *table##l = voice->layers[l].table;
+#define LAYER_LOAD_BLEP_SQUARE(l) LAYER_LOAD_OSC(l)
+#define LAYER_LOAD_BLEP_SAWTOOTH(l) LAYER_LOAD_OSC(l)
+#define LAYER_LOAD_BLEP_TRIANGLE(l) LAYER_LOAD_OSC(l)
+
+#define LAYER_TERM_NONE(l)
+#define LAYER_TERM_TABLE(l) +(qsample)wavetable_read(table##l, phase##l) * level##l
+#define LAYER_TERM_BLEP_SQUARE(l) +(qsample)polyblep_square(phase##l, phase_inc##l) * level##l
+#define LAYER_TERM_BLEP_SAWTOOTH(l) +(qsample)polyblep_sawtooth(phase##l, phase_inc##l) * level##l
+#define LAYER_TERM_BLEP_TRIANGLE(l) +(qsample)polyblep_triangle(phase##l, phase_inc##l) * level##l
+
+#define LAYER_STEP_NONE(l)
+#define LAYER_STEP_OSC(l) phase##l += phase_inc##l;
+#define LAYER_STEP_TABLE(l) LAYER_STEP_OSC(l)
+#define LAYER_STEP_BLEP_SQUARE(l) LAYER_STEP_OSC(l)
+#define LAYER_STEP_BLEP_SAWTOOTH(l) LAYER_STEP_OSC(l)
+#define LAYER_STEP_BLEP_TRIANGLE(l) LAYER_STEP_OSC(l)
+
+#define LAYER_STORE_NONE(l)
+#define LAYER_STORE_OSC(l) voice->layers[l].phase = phase##l;
+#define LAYER_STORE_TABLE(l) LAYER_STORE_OSC(l)
+#define LAYER_STORE_BLEP_SQUARE(l) LAYER_STORE_OSC(l)
+#define LAYER_STORE_BLEP_SAWTOOTH(l) LAYER_STORE_OSC(l)
+#define LAYER_STORE_BLEP_TRIANGLE(l) LAYER_STORE_OSC(l)
+
+#define FILTER_LOAD_NONE
+#define FILTER_LOAD_BIQUAD                                                    \
+    const BiquadCoeffs *coeffs = voice->filter.coeffs;                          \
+    const qsample a0 = coeffs->a0, a1 = coeffs->a1, a2 = coeffs->a2;            \
+    const qsample b1 = coeffs->b1, b2 = coeffs->b2;                            \
+    qsample s1 = voice->filter.s1[0], s2 = voice->filter.s2[0];
+#define FILTER_LOAD_BIQUAD2 \
+    FILTER_LOAD_BIQUAD      \
+    qsample t1 = voice->filter.s1[1], t2 = voice->filter.s2[1];
+
+#define FILTER_LOAD_SVF                                                             \
+    const qsample a1 = voice->svf.a1, a2 = voice->svf.a2, a3 = voice->svf.a3;      \
+    const qsample m0 = voice->svf.m0, m1 = voice->svf.m1, m2 = voice->svf.m2;      \
+    qsample ic1eq = voice->svf.ic1eq, ic2eq = voice->svf.ic2eq;
+
+#define FILTER_STEP_NONE(s)
+#define FILTER_STEP_BIQUAD(s)                                          \
+    {                                                                  \
+        qsample filtered = a0 * s + s1;                                \
+        s1 = a1 * s + s2 - b1 * filtered;                              \
+        s2 = a2 * s - b2 * filtered;                                   \
+        s = filtered;                                                  \
+    }
+#define FILTER_STEP_BIQUAD2(s)                                         \
+    FILTER_STEP_BIQUAD(s)                                              \
+    {                                                                  \
+        qsample filtered = a0 * s + t1;                                \
+        t1 = a1 * s + t2 - b1 * filtered;                              \
+        t2 = a2 * s - b2 * filtered;                                   \
+        s = filtered;                                                  \
+    }
+#define FILTER_STEP_SVF(s)                                   \
+    {                                                        \
+        qsample v3 = s - ic2eq;                              \
+        qsample band = a1 * ic1eq + a2 * v3;                 \
+        qsample low = ic2eq + a2 * ic1eq + a3 * v3;          \
+        ic1eq = 2 * band - ic1eq;                            \
+        ic2eq = 2 * low - ic2eq;                             \
+        s = m0 * s + m1 * band + m2 * low;                   \
+    }
+
+#define FILTER_STORE_NONE
+#define FILTER_STORE_BIQUAD    \
+    voice->filter.s1[0] = s1;  \
+    voice->filter.s2[0] = s2;
+#define FILTER_STORE_BIQUAD2   \
+    FILTER_STORE_BIQUAD        \
+    voice->filter.s1[1] = t1;  \
+    voice->filter.s2[1] = t2;
+#define FILTER_STORE_SVF       \
+    voice->svf.ic1eq = ic1eq;  \
+    voice->svf.ic2eq = ic2eq;
+
+#define VOICE_KERNEL_DEFINE(name, filter, k0, k1, k2, k3)                                        \
+    static void voice_kernel_##name(Voice *voice, const qsample *env, float *out, int frames)    \
+    {                                                                                            \
+        LAYER_LOAD_##k0(0) LAYER_LOAD_##k1(1) LAYER_LOAD_##k2(2) LAYER_LOAD_##k3(3)              \
+        FILTER_LOAD_##filter                                                                     \
+        const qsample amplitude = (qsample)voice->amplitude;                                     \
+                                                                                                 \
+        for (int i = 0; i < frames; i++)                                                         \
+        {                                                                                        \
+            qsample s = LAYER_TERM_##k0(0) LAYER_TERM_##k1(1) LAYER_TERM_##k2(2) LAYER_TERM_##k3(3); \
+            FILTER_STEP_##filter(s)                                                              \
+            out[i] = (float)(s * env[i] * amplitude);                                            \
+            LAYER_STEP_##k0(0) LAYER_STEP_##k1(1) LAYER_STEP_##k2(2) LAYER_STEP_##k3(3)          \
+        }                                                                                        \
+                                                                                                 \
+        LAYER_STORE_##k0(0) LAYER_STORE_##k1(1) LAYER_STORE_##k2(2) LAYER_STORE_##k3(3)          \
+        FILTER_STORE_##filter                                                                    \
+    }
+
+VOICE_KERNEL_LIST(VOICE_KERNEL_DEFINE)
+
+typedef enum
+{
+    VOICE_FILTER_NONE,
+    VOICE_FILTER_BIQUAD,
+    VOICE_FILTER_BIQUAD2, // two biquad sections in series
+    VOICE_FILTER_SVF,
+} VoiceFilterKind;
+
+typedef struct
+{
+    VoiceKernel kernel;
+    VoiceFilterKind filter;
+    LayerKind layers[MAX_TONE_LAYERS];
+} VoiceKernelEntry;
+
+#define VOICE_KERNEL_ENTRY(name, filter, k0, k1, k2, k3) \
+    {voice_kernel_##name, VOICE_FILTER_##filter, {LAYER_##k0, LAYER_##k1, LAYER_##k2, LAYER_##k3}},
+
+static const VoiceKernelEntry voice_kernels[] = {VOICE_KERNEL_LIST(VOICE_KERNEL_ENTRY)};
+
+// dispatch once per note, the render plan is fixed from here on
+static VoiceKernel voice_pick_kernel(const Voice *voice)
+{
+    VoiceFilterKind filter = VOICE_FILTER_NONE;
+    if (voice->filter.cfg.filter_type != FILTER_NONE)
+        filter = voice->filter.cfg.topology == FILTER_TOPOLOGY_SVF ? VOICE_FILTER_SVF : VOICE_FILTER_BIQUAD;
+
+    // the fused kernels inline one or two sections, longer cascades run as a block in the generic path
+    if (filter == VOICE_FILTER_BIQUAD && biquad_stages(&voice->filter.cfg) > 1)
+    {
+        if (biquad_stages(&voice->filter.cfg) > 2)
+            return voice_kernel_generic;
+        filter = VOICE_FILTER_BIQUAD2;
+    }
+
+    for (size_t k = 0; k < sizeof(voice_kernels) / sizeof(voice_kernels[0]); k++)
+    {
+        const VoiceKernelEntry *entry = &voice_kernels[k];
+        if (entry->filter != filter)
+            continue;
+
+        bool match = true;
+        for (int l = 0; l < MAX_TONE_LAYERS && match; l++)
+            match = entry->layers[l] == (l < voice->layer_n ? voice->layers[l].kind : LAYER_NONE);
+
+        if (match)
+            return entry->kernel;
+    }
+
+    return voice_kernel_generic;
+}
+
+// compile the tone into the render plan, the detune and so the mip level are fixed for the lifetime of the note
+static void voice_compile(Voice *voice, double sample_rate)
+{
+    const Tone *tone = voice->tone;
+    voice->layer_n = 0;
+
+    for (int i = 0; i < MAX_TONE_LAYERS; i++)
+    {
+        const Wave *wave = &tone->layers[i];
+        if (wave->type == WAVE_NONE || tone->mix_levels[i] == 0.0)
+            continue;
+
+        VoiceLayer *layer = &voice->layers[voice->layer_n++];
+        double frequency = voice->frequency * fastmath_exp2(tone->detune[i] / 12.0);
+
+        layer->phase_inc = wavetable_phase_increment(frequency, sample_rate);
+        layer->base_inc = layer->phase_inc;
+        layer->wave = wave->type;
+        layer->table = wavetable_lookup(wave->type, layer->phase_inc);
+        layer->level = (qsample)tone->mix_levels[i];
+        layer_bind_kernel(layer, wave, noise_hash(voice->noise_seed, (uint32_t)i));
+
+        // the layer phase offset in degrees becomes the start phase of the accumulator
+        double offset = tone->phase_diff[i] / 360.0;
+        layer->phase = (uint32_t)((offset - floor(offset)) * 4294967296.0);
+    }
+}
+
+bool voice_tone_is_fused(const Tone *tone, double sample_rate)
+{
+    Voice voice;
+    voice_init(&voice);
+    voice.tone = tone;
+    voice.frequency = 440.0;
+
+    biquad_init(&voice.filter, &tone->filter_opt, NULL);
+    biquad_sweep_start(&voice.filter_sweep, &voice.filter, tone->filter_opt.cutoff, sample_rate);
+    voice_compile(&voice, sample_rate);
+    return voice_pick_kernel(&voice) != voice_kernel_generic;
+}
+
+#define MOD_CUTOFF_MIN 20.0
+#define MOD_CUTOFF_MAX_RATIO 0.45 // of the sample rate, the biquad design breaks down at nyquist
+
+// phase increment of a layer shifted by a pitch offset in semitones
+static uint32_t voice_mod_inc(const VoiceLayer *layer, double semitones)
+{
+    double inc = layer->base_inc * fastmath_exp2(semitones / 12.0);
+    return inc < 2147483647.0 ? (uint32_t)inc : 2147483647u; // nyquist at most
+}
+
+static double voice_clamp_cutoff(const Voice *voice, double cutoff)
+{
+    double cutoff_max = voice->_sample_rate * MOD_CUTOFF_MAX_RATIO;
+    return cutoff < MOD_CUTOFF_MIN ? MOD_CUTOFF_MIN : cutoff > cutoff_max ? cutoff_max : cutoff;
+}
+
+// filter cutoff of the tone shifted by an offset in octaves
+static double voice_mod_cutoff(const Voice *voice, double octaves)
+{
+    return voice_clamp_cutoff(voice, voice->tone->filter_opt.cutoff * fastmath_exp2(octaves));
+}
+
+static bool voice_mod_sweeps_cutoff(const Voice *voice)
+{
+    return mod_routes(&voice->mod, MOD_DST_CUTOFF) && voice->filter.cfg.filter_type != FILTER_NONE;
+}
+
+// note on: pitch and cutoff start at the value of the first tick
+static void voice_mod_start(Voice *voice)
+{
+    const ModState *mod = &voice->mod;
+
+    if (mod_routes(mod, MOD_DST_PITCH))
+    {
+        for (int l = 0; l < voice->layer_n; l++)
+        {
+            VoiceLayer *layer = &voice->layers[l];
+            layer->phase_inc = voice_mod_inc(layer, mod->value[MOD_DST_PITCH]);
+            layer->inc_step = 0;
+            layer->table = wavetable_lookup(layer->wave, layer->phase_inc);
+        }
+    }
+
+    if (voice_mod_sweeps_cutoff(voice))
+    {
+        double cutoff = voice_mod_cutoff(voice, mod->value[MOD_DST_CUTOFF]);
+        if (voice->filter.cfg.topology == FILTER_TOPOLOGY_SVF)
+            svf_set_cutoff(&voice->svf, cutoff);
+        else
+            biquad_sweep_start(&voice->filter_sweep, &voice->filter, cutoff, voice->_sample_rate);
+    }
+}
+
+// control tick: the phase increments and the biquad coefficients ramp from the previous tick to this one over the
+// next MOD_CONTROL_RATE frames, the svf cutoff follows mod_value_at frame by frame in voice_render_swept
+static void voice_mod_tick(Voice *voice)
+{
+    ModState *mod = &voice->mod;
+    mod_tick(mod);
+
+    if (mod_routes(mod, MOD_DST_PITCH))
+    {
+        for (int l = 0; l < voice->layer_n; l++)
+        {
+            VoiceLayer *layer = &voice->layers[l];
+            uint32_t target = voice_mod_inc(layer, mod->value[MOD_DST_PITCH]);
+            layer->inc_step = (int32_t)(((int64_t)target - (int64_t)layer->phase_inc) / MOD_CONTROL_RATE);
+
+            // mip level of the higher end, the ramp stays free of aliasing
+            layer->table = wavetable_lookup(layer->wave, target > layer->phase_inc ? target : layer->phase_inc);
+        }
+    }
+
+    // one design per tick, the frames in between interpolate the coefficients
+    if (voice_mod_sweeps_cutoff(voice) && voice->filter.cfg.topology != FILTER_TOPOLOGY_SVF)
+        biquad_sweep_to(&voice->filter_sweep, &voice->filter, voice_mod_cutoff(voice, mod->value[MOD_DST_CUTOFF]),
+                        MOD_CONTROL_RATE, voice->_sample_rate);
 }
 
 void voice_start(Voice *voice, double sample_rate)
 {
-    adsr_init(&voice->envelope, &voice->tone->envelope_opt);
-    biquad_init(&voice->filter, &voice->tone->filter_opt, sample_rate);
+    adsr_init(&voice->envelope, &voice->tone->envelope_opt, sample_rate);
+    biquad_init(&voice->filter, &voice->tone->filter_opt, voice->filter_coeffs);
+    if (!voice->filter_coeffs)
+        biquad_sweep_start(&voice->filter_sweep, &voice->filter, voice->tone->filter_opt.cutoff, sample_rate);
+    if (voice->filter.cfg.topology == FILTER_TOPOLOGY_SVF)
+        svf_init(&voice->svf, &voice->tone->filter_opt, sample_rate);
     voice->_sample_rate = sample_rate;
 
-    stream_init(&voice->streamer, voice->stream_buf, VOICE_BUFFER_SIZE);
+    voice_compile(voice, sample_rate);
+    voice->kernel = voice_pick_kernel(voice);
+
+    mod_init(&voice->mod, &voice->tone->mod, sample_rate);
+    if (voice->mod.route_n)
+        voice_mod_start(voice);
 
     adsr_note_on(&voice->envelope);
     biquad_reset(&voice->filter);
+    svf_reset(&voice->svf);
 
     voice->active = true; // MUST set active in the end of function
 }
@@ -42,53 +460,164 @@ void voice_end(Voice *voice)
     // printf("end voice\n");
     voice->voice_is_end = true;
     adsr_note_off(&voice->envelope);
+    mod_note_off(&voice->mod);
 }
 
-double voice_step(Voice *voice, double delta_time)
+void voice_render_envelope(Voice *voice, qsample *env, int stride, int frames)
 {
-    if (!voice->active)
-        return 0.0;
+    double delta_time = 1.0 / voice->_sample_rate;
 
-    // if note controlled by duration, check if need to end voice
-    voice->cur_duration += delta_time;
-    if (voice->control_mode == NOTE_CONTROL_DURATION && !voice->voice_is_end && voice->cur_duration * 1000 >= voice->duration_ms)
+    // frame at which a duration controlled note has to be released
+    int end_frame = frames;
+    if (voice->control_mode == NOTE_CONTROL_DURATION && !voice->voice_is_end)
+    {
+        double remaining = voice->duration_ms / 1000.0 - voice->cur_duration;
+        end_frame = (int)ceil(remaining / delta_time) - 1;
+        if (end_frame < 0)
+            end_frame = 0;
+        if (end_frame > frames)
+            end_frame = frames;
+    }
+    voice->cur_duration += frames * delta_time;
+
+    adsr_render_block(&voice->envelope, env, stride, end_frame);
+    if (end_frame < frames)
+    {
         voice_end(voice);
+        adsr_render_block(&voice->envelope, env + end_frame * stride, stride, frames - end_frame);
+    }
+}
 
-    double envelope = adsr_process(&voice->envelope, delta_time);
+void voice_apply_release(Voice *voice)
+{
+    if (atomic_load_explicit(&voice->release_pending, memory_order_acquire))
+    {
+        atomic_store_explicit(&voice->release_pending, false, memory_order_relaxed);
+        if (!voice->voice_is_end)
+            voice_end(voice);
+    }
+}
 
-    double base_phase_increment = phase_increment(voice->frequency, voice->_sample_rate);
-    double sample_mixed = 0.0;
+// generic path of pitch and cutoff modulated voices, pos is the frame of the control tick the chunk starts at
+// oscillators advance with ramping phase increments, the svf follows the cutoff of every frame and the biquad
+// interpolates the designs of the last two ticks
+static void voice_render_swept(Voice *voice, const qsample *env, float *out, int frames, int pos)
+{
+    qsample mix[RENDER_BLOCK_SIZE];
+    bool pitch = mod_routes(&voice->mod, MOD_DST_PITCH);
 
-    for (int i = 0; i < MAX_TONE_LAYERS; i++)
+    memset(mix, 0, frames * sizeof(qsample));
+    for (int l = 0; l < voice->layer_n; l++)
     {
-        // convert semitones to frequency ratio
-        double detuned_phase_inc = base_phase_increment *
-                                   pow(2.0, voice->tone->detune[i] / 12.0);
+        VoiceLayer *layer = &voice->layers[l];
+        if (pitch)
+            layer->render_ramp(layer, mix, frames);
+        else
+            layer->render(layer, mix, frames);
+    }
 
-        double layer_sample = generate_waveform(
-            voice->tone->layers[i].type,
-            voice->phases[i] + voice->tone->phase_diff[i]);
+    if (voice_mod_sweeps_cutoff(voice) && voice->filter.cfg.topology == FILTER_TOPOLOGY_SVF)
+    {
+        // the offset ramps linearly in octaves, so the cutoff moves by a constant ratio per frame
+        const ModState *mod = &voice->mod;
+        double octave_step = (mod->value[MOD_DST_CUTOFF] - mod->prev[MOD_DST_CUTOFF]) * (1.0 / MOD_CONTROL_RATE);
+        double ratio = fastmath_exp2(octave_step);
+        double swept = voice->tone->filter_opt.cutoff * fastmath_exp2(mod_value_at(mod, MOD_DST_CUTOFF, pos));
 
-        sample_mixed += layer_sample * voice->tone->mix_levels[i];
+        double cutoff[RENDER_BLOCK_SIZE];
+        for (int i = 0; i < frames; i++)
+        {
+            cutoff[i] = voice_clamp_cutoff(voice, swept);
+            swept *= ratio;
+        }
 
-        voice->phases[i] += detuned_phase_inc;
-        voice->phases[i] = wrap_phase(voice->phases[i]);
+        svf_process_block_sweep(&voice->svf, mix, cutoff, frames);
     }
+    else if (voice_mod_sweeps_cutoff(voice))
+        biquad_process_block_sweep(&voice->filter, &voice->filter_sweep, mix, frames);
+    else
+        voice_filter_block(voice, mix, frames);
 
-    // apply filter
-    if (voice->filter.cfg.filter_type != FILTER_NONE)
+    for (int i = 0; i < frames; i++)
+        out[i] = (float)(mix[i] * env[i] * (qsample)voice->amplitude);
+}
+
+// control ticks split the chunk, every target moves frame by frame between the last two ticks
+// voices that only modulate amplitude or pan keep their fused kernel
+static void voice_render_modulated(Voice *voice, qsample *env, float *out, int frames)
+{
+    ModState *mod = &voice->mod;
+    bool amp = mod_routes(mod, MOD_DST_AMP);
+    bool pan = mod_routes(mod, MOD_DST_PAN);
+    bool swept = mod_routes(mod, MOD_DST_PITCH) || voice_mod_sweeps_cutoff(voice);
+    qsample *pan_out = voice->pan_block;
+
+    while (frames > 0)
     {
-        sample_mixed = biquad_process(&voice->filter, sample_mixed);
+        if (mod->tick_left == 0)
+            voice_mod_tick(voice);
+
+        int n = frames < mod->tick_left ? frames : mod->tick_left;
+        int pos = MOD_CONTROL_RATE - mod->tick_left;
+
+        if (amp)
+        {
+            for (int i = 0; i < n; i++)
+                env[i] *= (qsample)fmax(0.0, 1.0 + mod_value_at(mod, MOD_DST_AMP, pos + i));
+        }
+        if (pan)
+        {
+            for (int i = 0; i < n; i++)
+                pan_out[i] = (qsample)fmin(1.0, fmax(0.0, voice->pan + mod_value_at(mod, MOD_DST_PAN, pos + i)));
+        }
+
+        if (swept)
+            voice_render_swept(voice, env, out, n, pos);
+        else
+            voice->kernel(voice, env, out, n);
+
+        mod->tick_left -= n;
+        env += n;
+        out += n;
+        pan_out += n;
+        frames -= n;
     }
+}
+
+static void voice_render_chunk(Voice *voice, float *out, int frames)
+{
+    qsample env[RENDER_BLOCK_SIZE];
 
-    // apply envelope
-    sample_mixed *= envelope * voice->amplitude;
+    voice_render_envelope(voice, env, 1, frames);
 
-    // update voice status
-    if (!adsr_is_active(&voice->envelope))
+    // oscillators, filter, envelope and amplitude
+    if (voice->mod.route_n)
+        voice_render_modulated(voice, env, out, frames);
+    else
+        voice->kernel(voice, env, out, frames);
+}
+
+bool voice_render_block(Voice *voice, float *out, int frames)
+{
+    voice_apply_release(voice);
+
+    while (frames > 0)
     {
-        voice->active = false;
+        int chunk = frames > RENDER_BLOCK_SIZE ? RENDER_BLOCK_SIZE : frames;
+
+        if (adsr_is_active(&voice->envelope))
+            voice_render_chunk(voice, out, chunk);
+        else
+            memset(out, 0, chunk * sizeof(float));
+
+        out += chunk;
+        frames -= chunk;
     }
 
-    return sample_mixed;
+    return adsr_is_active(&voice->envelope);
+}
+
+void voice_retire(Voice *voice)
+{
+    atomic_store_explicit(&voice->active, false, memory_order_release);
 }
\ No newline at end of file
@@ -7,8 +7,53 @@
 #include "tone.h"
 #include "stream.h"
 #include "../envelope/adsr.h"
+#include "../filters/svf.h"
+#include "../oscillators/noise.h"
+#include "../utils/sample.h"
 
-typedef struct
+typedef enum
+{
+    LAYER_NONE = 0,
+    LAYER_TABLE,
+    LAYER_BLEP_SQUARE,
+    LAYER_BLEP_SAWTOOTH,
+    LAYER_BLEP_TRIANGLE,
+    LAYER_NOISE,
+} LayerKind;
+
+typedef struct VoiceLayer VoiceLayer;
+
+// one audible layer of the render plan, bound to the kernel of its waveform at note on
+struct VoiceLayer
+{
+    void (*render)(VoiceLayer *layer, qsample *mix, int frames);      // accumulate frames into mix, advances phase
+    void (*render_ramp)(VoiceLayer *layer, qsample *mix, int frames); // same while phase_inc moves by inc_step per frame
+    LayerKind kind;
+
+    const float *table; // wavetable mip level, table kernels only
+    uint32_t phase;     // DDS phase, 2^32 is one cycle
+    uint32_t phase_inc; // detuned phase increment
+    uint32_t base_inc;  // phase_inc before pitch modulation
+    int32_t inc_step;   // change of phase_inc per frame while the pitch ramps to the next control tick
+    WaveType wave;      // mip level lookup when the pitch is modulated
+    qsample level;      // mix level
+    NoiseGen noise;     // noise kernels only
+};
+
+// threaded mode owner of a voice stream, every stage is left only by the side it names
+typedef enum
+{
+    VOICE_STREAM_IDLE = 0, // control side, the stream may be reset for the next note
+    VOICE_STREAM_PLAYING,  // generator thread writes, mixer reads
+    VOICE_STREAM_ENDED,    // generator wrote its last samples, mixer drains the tail
+} VoiceStreamStage;
+
+typedef struct Voice Voice;
+
+// renders oscillators, filter, envelope and amplitude of one chunk, env holds the envelope per frame
+typedef void (*VoiceKernel)(Voice *voice, const qsample *env, float *out, int frames);
+
+struct Voice
 {
     const Tone *tone; // What to play
     double velocity;  // Playing strength (0.0-1.0)
@@ -19,23 +64,72 @@ typedef struct
     NoteControlMode control_mode;
 
     // state
-    bool active;
-    double phases[MAX_TONE_LAYERS]; // phase for each toneblock
+    atomic_bool active;
+    atomic_bool release_pending; // note off requested, applied by the rendering thread
+    int note_id;                 // id handed out by synth_play_note
+    uint32_t noise_seed;         // keys the noise streams of the layers, set before voice_start
+    const BiquadCoeffs *filter_coeffs; // shared coefficients of the tone filter, set before voice_start, NULL designs its own
+    VoiceLayer layers[MAX_TONE_LAYERS]; // render plan, silent layers of the tone are dropped
+    int layer_n;
+    VoiceKernel kernel; // picked once at note on
     double cur_duration;
     bool voice_is_end;
     double _sample_rate;
 
     // lefted filter/envelope
     BiquadFilter filter;
+    BiquadSweep filter_sweep; // own coefficients of the biquad, only used when swept or without filter_coeffs
+    SvfFilter svf; // used instead of the biquad when filter.cfg.topology is FILTER_TOPOLOGY_SVF
     ADSREnvelope envelope;
 
+    // control rate modulation of the tone
+    ModState mod;
+    qsample pan_block[RENDER_BLOCK_SIZE]; // pan of each frame of the last chunk, pan routed voices only
+
     // streaming state
-    double stream_buf[VOICE_BUFFER_SIZE];
-    AudioStreamBuffer streamer; // buffer for streaming audio
-} Voice;
+    AudioStreamBuffer streamer; // buffer for streaming audio, storage is owned by the synth
+    atomic_int stream_stage;    // VoiceStreamStage, threaded mode only
+};
 
 // void voice_init(Voice *voice, double sample_rate);
 void voice_init(Voice *voice);
 void voice_start(Voice *voice, double sample_rate);
 void voice_end(Voice *voice);
-double voice_step(Voice *voice, double delta_time);
\ No newline at end of file
+
+/**
+ * Render a block of the voice, frames after the end of the envelope are silent
+ * @param voice Voice to render
+ * @param out Receives the samples
+ * @param frames Frames to render
+ * @return false once the envelope is done, retire the voice after its samples are delivered
+ */
+bool voice_render_block(Voice *voice, float *out, int frames);
+
+/**
+ * Flag a voice whose last samples are delivered inactive (render thread), pairs with an acquire load of active
+ * @param voice Voice to retire
+ */
+void voice_retire(Voice *voice);
+
+/**
+ * Check whether notes of a tone get a fused kernel of voice_kernels.h or fall back to the generic path
+ * @param tone Tone to compile
+ * @param sample_rate Sample rate the tone plays at
+ * @return true if a fused kernel matches the render plan
+ */
+bool voice_tone_is_fused(const Tone *tone, double sample_rate);
+
+/**
+ * Consume a pending note off (render thread)
+ * @param voice Voice to update
+ */
+void voice_apply_release(Voice *voice);
+
+/**
+ * Advance the envelope and duration of a chunk, the voice stays active until it is retired
+ * @param voice Voice to advance
+ * @param env Receives the envelope level of each frame
+ * @param stride Distance between two frames in env, lets banks write interleaved
+ * @param frames Frames to advance, at most RENDER_BLOCK_SIZE
+ */
+void voice_render_envelope(Voice *voice, qsample *env, int stride, int frames);
\ No newline at end of file
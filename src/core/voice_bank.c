@@ -0,0 +1,318 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "voice_bank.h"
+#include "dsp_kernels.h"
+
+#include "../oscillators/wavetable.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+_Static_assert(MAX_TONE_LAYERS == 4, "voice_group_render dispatches 1 to 4 layers");
+_Static_assert(VOICE_BANK_LANES == BIQUAD_LANES, "one biquad lane per voice");
+
+// longest cascade a group renders, every stage count is one more copy of the output loop
+#define VOICE_BANK_MAX_STAGES 2
+
+static int voice_filter_stages(const Voice *voice)
+{
+    return voice->filter.cfg.filter_type == FILTER_NONE ? 0 : biquad_stages(&voice->filter.cfg);
+}
+
+bool voice_bank_accepts(const Voice *voice)
+{
+    // modulated voices change pitch and cutoff per control tick, they render on their own
+    if (voice->layer_n == 0 || voice->mod.route_n)
+        return false;
+
+    // lanes carry biquad state only
+    if (voice->filter.cfg.filter_type != FILTER_NONE && voice->filter.cfg.topology == FILTER_TOPOLOGY_SVF)
+        return false;
+    if (voice_filter_stages(voice) > VOICE_BANK_MAX_STAGES)
+        return false;
+
+    for (int l = 0; l < voice->layer_n; l++)
+    {
+        if (voice->layers[l].kind != LAYER_TABLE)
+            return false;
+    }
+    return true;
+}
+
+bool voice_group_fits(const VoiceGroup *group, const Voice *voice)
+{
+    return group->lane_n < VOICE_BANK_LANES &&
+           group->layer_n == voice->layer_n &&
+           group->stages == voice_filter_stages(voice);
+}
+
+void voice_group_add(VoiceGroup *group, const Voice *voice, int voice_idx)
+{
+    if (group->lane_n == 0)
+    {
+        group->layer_n = voice->layer_n;
+        group->stages = voice_filter_stages(voice);
+    }
+    group->voices[group->lane_n++] = voice_idx;
+}
+
+// copy the hot state of every lane into the bank and advance the envelopes
+// free lanes keep zero increments, levels and coefficients and read the first table sample
+static void voice_bank_gather(VoiceBank *bank, const VoiceGroup *group, Voice *voices, int frames)
+{
+    const float *base = wavetable_base();
+
+    memset(bank, 0, offsetof(VoiceBank, mix));
+
+    for (int lane = 0; lane < VOICE_BANK_LANES; lane++)
+    {
+        if (lane >= group->lane_n)
+        {
+            for (int i = 0; i < frames; i++)
+                bank->env[i][lane] = 0.0;
+            continue;
+        }
+
+        Voice *voice = &voices[group->voices[lane]];
+
+        for (int l = 0; l < group->layer_n; l++)
+        {
+            bank->phase[l][lane] = voice->layers[l].phase;
+            bank->phase_inc[l][lane] = voice->layers[l].phase_inc;
+            bank->table[l][lane] = (int32_t)(voice->layers[l].table - base);
+            bank->level[l][lane] = voice->layers[l].level;
+        }
+
+        const BiquadCoeffs *coeffs = voice->filter.coeffs;
+        bank->filter.a0[lane] = coeffs->a0;
+        bank->filter.a1[lane] = coeffs->a1;
+        bank->filter.a2[lane] = coeffs->a2;
+        bank->filter.b1[lane] = coeffs->b1;
+        bank->filter.b2[lane] = coeffs->b2;
+        for (int st = 0; st < group->stages; st++)
+        {
+            bank->filter.s1[st][lane] = voice->filter.s1[st];
+            bank->filter.s2[st][lane] = voice->filter.s2[st];
+        }
+        bank->amplitude[lane] = (qsample)voice->amplitude;
+
+        voice_apply_release(voice);
+        voice_render_envelope(voice, &bank->env[0][lane], VOICE_BANK_LANES, frames);
+    }
+}
+
+static void voice_bank_scatter(const VoiceBank *bank, const VoiceGroup *group, Voice *voices, float *voice_block,
+                               int frames)
+{
+    for (int lane = 0; lane < group->lane_n; lane++)
+    {
+        int v = group->voices[lane];
+        Voice *voice = &voices[v];
+
+        for (int l = 0; l < group->layer_n; l++)
+            voice->layers[l].phase = bank->phase[l][lane];
+
+        for (int st = 0; st < group->stages; st++)
+        {
+            voice->filter.s1[st] = bank->filter.s1[st][lane];
+            voice->filter.s2[st] = bank->filter.s2[st][lane];
+        }
+
+        float *out = &voice_block[v * RENDER_BLOCK_SIZE];
+        for (int i = 0; i < frames; i++)
+            out[i] = (float)bank->mix[i][lane];
+
+        // the last samples are in the block, the voice can go
+        if (!adsr_is_active(&voice->envelope))
+            voice_retire(voice);
+    }
+}
+
+// fetch one table sample per lane, the fetch is a parameter of the always inlined kernels so the group renderer
+// takes the widest gather its level has, vectors go by pointer as their by-value ABI depends on the level
+typedef void (*BankGatherFn)(bank_f32 *value, const float *base, const bank_i32 *index);
+
+static inline __attribute__((always_inline)) void bank_gather_generic(bank_f32 *value, const float *base,
+                                                                      const bank_i32 *index)
+{
+    for (int lane = 0; lane < VOICE_BANK_LANES; lane++)
+        (*value)[lane] = base[(*index)[lane]];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+_Static_assert(VOICE_BANK_LANES % 8 == 0, "bank_gather_avx2 fetches 8 floats at a time");
+
+static inline __attribute__((always_inline)) DSP_TARGET_AVX2 void bank_gather_avx2(bank_f32 *value, const float *base,
+                                                                                   const bank_i32 *index)
+{
+    for (int lane = 0; lane < VOICE_BANK_LANES; lane += 8)
+    {
+        __m256i lanes;
+        memcpy(&lanes, (const int32_t *)index + lane, sizeof(lanes));
+        __m256 fetched = _mm256_i32gather_ps(base, lanes, sizeof(float));
+        memcpy((float *)value + lane, &fetched, sizeof(fetched));
+    }
+}
+
+#if VOICE_BANK_LANES % 16 == 0
+static inline __attribute__((always_inline)) DSP_TARGET_AVX512 void bank_gather_avx512(bank_f32 *value,
+                                                                                       const float *base,
+                                                                                       const bank_i32 *index)
+{
+    for (int lane = 0; lane < VOICE_BANK_LANES; lane += 16)
+    {
+        __m512i lanes;
+        memcpy(&lanes, (const int32_t *)index + lane, sizeof(lanes));
+        __m512 fetched = _mm512_i32gather_ps(lanes, base, sizeof(float));
+        memcpy((float *)value + lane, &fetched, sizeof(fetched));
+    }
+}
+#else
+#define bank_gather_avx512 bank_gather_avx2 // 8 floats fit one AVX2 gather
+#endif
+#else
+#define bank_gather_avx2 bank_gather_generic
+#define bank_gather_avx512 bank_gather_generic
+#endif
+
+// wavetable_read on every lane
+static inline __attribute__((always_inline)) void bank_table_read(bank_qs *value, const float *base,
+                                                                  const bank_i32 *table, const bank_u32 *phase,
+                                                                  BankGatherFn gather)
+{
+    bank_i32 index = *table + (bank_i32)(*phase >> WAVETABLE_FRAC_BITS);
+    bank_f32 frac = __builtin_convertvector(*phase & ((1u << WAVETABLE_FRAC_BITS) - 1), bank_f32) * WAVETABLE_FRAC_SCALE;
+
+#if WAVETABLE_CUBIC
+    bank_f32 y0, y1, y2, y3;
+    gather(&y0, base - 1, &index);
+    gather(&y1, base, &index);
+    gather(&y2, base + 1, &index);
+    gather(&y3, base + 2, &index);
+
+    bank_f32 c1 = 0.5f * (y2 - y0);
+    bank_f32 c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+    bank_f32 c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+    *value = __builtin_convertvector(((c3 * frac + c2) * frac + c1) * frac + y1, bank_qs);
+#else
+    bank_f32 y1, y2;
+    gather(&y1, base, &index);
+    gather(&y2, base + 1, &index);
+    *value = __builtin_convertvector(y1 + frac * (y2 - y1), bank_qs);
+#endif
+}
+
+// oscillators of all lanes into the mix, same summation order as the scalar kernels so lanes come out bit identical
+// layer_n is a constant at every call site, each one becomes its own loop
+static inline __attribute__((always_inline)) void voice_bank_run_oscillators(VoiceBank *bank, int frames,
+                                                                             const int layer_n, BankGatherFn gather)
+{
+    const float *base = wavetable_base();
+
+    bank_u32 phase[MAX_TONE_LAYERS], phase_inc[MAX_TONE_LAYERS];
+    bank_i32 table[MAX_TONE_LAYERS];
+    bank_qs level[MAX_TONE_LAYERS];
+    for (int l = 0; l < layer_n; l++)
+    {
+        memcpy(&phase[l], bank->phase[l], sizeof(bank_u32));
+        memcpy(&phase_inc[l], bank->phase_inc[l], sizeof(bank_u32));
+        memcpy(&table[l], bank->table[l], sizeof(bank_i32));
+        memcpy(&level[l], bank->level[l], sizeof(bank_qs));
+    }
+
+    for (int i = 0; i < frames; i++)
+    {
+        bank_qs s, value;
+        bank_table_read(&s, base, &table[0], &phase[0], gather);
+        s *= level[0];
+        phase[0] += phase_inc[0];
+
+        for (int l = 1; l < layer_n; l++)
+        {
+            bank_table_read(&value, base, &table[l], &phase[l], gather);
+            s += value * level[l];
+            phase[l] += phase_inc[l];
+        }
+
+        memcpy(bank->mix[i], &s, sizeof(bank_qs));
+    }
+
+    for (int l = 0; l < layer_n; l++)
+        memcpy(bank->phase[l], &phase[l], sizeof(bank_u32));
+}
+
+// filter, envelope and amplitude, the biquads of all lanes run side by side
+// stages is a constant at every call site, 0 skips the filter
+static inline __attribute__((always_inline)) void voice_bank_run_output(VoiceBank *bank, int frames,
+                                                                        const int stages)
+{
+    BiquadLanesRegs filter;
+    bank_qs amplitude;
+    biquad_lanes_load(&filter, &bank->filter, stages);
+    memcpy(&amplitude, bank->amplitude, sizeof(bank_qs));
+
+    for (int i = 0; i < frames; i++)
+    {
+        bank_qs s, env;
+        memcpy(&s, bank->mix[i], sizeof(bank_qs));
+        memcpy(&env, bank->env[i], sizeof(bank_qs));
+
+        biquad_lanes_step(&filter, &s, stages);
+
+        s = s * env * amplitude;
+        memcpy(bank->mix[i], &s, sizeof(bank_qs));
+    }
+
+    biquad_lanes_store(&filter, &bank->filter, stages);
+}
+
+static inline __attribute__((always_inline)) void voice_group_render_impl(const VoiceGroup *group, Voice *voices,
+                                                                          float *voice_block, int frames,
+                                                                          BankGatherFn gather)
+{
+    VoiceBank bank;
+
+    voice_bank_gather(&bank, group, voices, frames);
+
+    switch (group->layer_n)
+    {
+    case 1:
+        voice_bank_run_oscillators(&bank, frames, 1, gather);
+        break;
+    case 2:
+        voice_bank_run_oscillators(&bank, frames, 2, gather);
+        break;
+    case 3:
+        voice_bank_run_oscillators(&bank, frames, 3, gather);
+        break;
+    default:
+        voice_bank_run_oscillators(&bank, frames, 4, gather);
+        break;
+    }
+
+    switch (group->stages)
+    {
+    case 0:
+        voice_bank_run_output(&bank, frames, 0);
+        break;
+    case 1:
+        voice_bank_run_output(&bank, frames, 1);
+        break;
+    default:
+        voice_bank_run_output(&bank, frames, VOICE_BANK_MAX_STAGES);
+        break;
+    }
+
+    voice_bank_scatter(&bank, group, voices, voice_block, frames);
+}
+
+#define VOICE_GROUP_RENDER_DEFINE(suffix, target)                                                      \
+    target void voice_group_render_##suffix(const VoiceGroup *group, Voice *voices, float *voice_block, \
+                                            int frames)                                                \
+    {                                                                                                  \
+        voice_group_render_impl(group, voices, voice_block, frames, bank_gather_##suffix);             \
+    }
+// the lane count is fixed, each level splits a lane vector into as many registers as it needs
+DSP_KERNEL_VARIANTS(VOICE_GROUP_RENDER_DEFINE)
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "voice.h"
+#include "../filters/biquad_lanes.h"
+
+// voices rendered side by side, 4 SSE2, 2 AVX2 or 1 AVX-512 vector(s) of samples
+#if QSYNTH_FLOAT32
+#define VOICE_BANK_LANES 16
+#else
+#define VOICE_BANK_LANES 8
+#endif
+
+// lane vectors, the compiler lowers them to the widest registers of the target
+typedef qsample bank_qs __attribute__((vector_size(VOICE_BANK_LANES * sizeof(qsample))));
+typedef float bank_f32 __attribute__((vector_size(VOICE_BANK_LANES * sizeof(float))));
+typedef uint32_t bank_u32 __attribute__((vector_size(VOICE_BANK_LANES * sizeof(uint32_t))));
+typedef int32_t bank_i32 __attribute__((vector_size(VOICE_BANK_LANES * sizeof(int32_t))));
+
+// voices with the same render plan shape, picked by the render thread for one span
+typedef struct
+{
+    int voices[VOICE_BANK_LANES]; // voice pool indices
+    int lane_n;
+    int layer_n;
+    int stages; // biquad sections, 0 = unfiltered
+} VoiceGroup;
+
+// Structure of arrays copy of the hot state of a group, one lane per voice
+// Gathered from the voices at the start of a span and written back at the end, so the render loops only
+// touch these contiguous arrays
+typedef struct
+{
+    uint32_t phase[MAX_TONE_LAYERS][VOICE_BANK_LANES];
+    uint32_t phase_inc[MAX_TONE_LAYERS][VOICE_BANK_LANES];
+    int32_t table[MAX_TONE_LAYERS][VOICE_BANK_LANES]; // offset from wavetable_base()
+    qsample level[MAX_TONE_LAYERS][VOICE_BANK_LANES];
+
+    BiquadLanes filter;
+
+    qsample amplitude[VOICE_BANK_LANES];
+
+    // frame major
+    qsample mix[RENDER_BLOCK_SIZE][VOICE_BANK_LANES]; // oscillator sum, then the voice output
+    qsample env[RENDER_BLOCK_SIZE][VOICE_BANK_LANES];
+} VoiceBank;
+
+/**
+ * Check whether a voice can be rendered in a group, only wavetable layers are vectorized
+ * @param voice Active voice
+ * @return true if the voice can join a group
+ */
+bool voice_bank_accepts(const Voice *voice);
+
+/**
+ * Check whether a voice fits into a group
+ * @param group Group to check
+ * @param voice Voice accepted by voice_bank_accepts
+ * @return true if the group has a free lane and the same plan shape
+ */
+bool voice_group_fits(const VoiceGroup *group, const Voice *voice);
+
+/**
+ * Add a voice to a group, start a new group with lane_n = 0
+ * @param group Group to add to
+ * @param voice Voice accepted by voice_bank_accepts
+ * @param voice_idx Voice pool index
+ */
+void voice_group_add(VoiceGroup *group, const Voice *voice, int voice_idx);
+
+/**
+ * Render all voices of a group, same result as voice_render_block for each of them
+ * One variant per DspIsa level from the same source, reach it through dsp_kernels_select
+ * @param group Group to render
+ * @param voices Voice pool
+ * @param voice_block Output blocks, RENDER_BLOCK_SIZE floats per voice pool index
+ * @param frames Frames to render, at most RENDER_BLOCK_SIZE
+ */
+#define VOICE_GROUP_RENDER_DECLARE(suffix, target) \
+    void voice_group_render_##suffix(const VoiceGroup *group, Voice *voices, float *voice_block, int frames);
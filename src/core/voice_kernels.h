@@ -0,0 +1,20 @@
+#pragma once
+
+// Fused voice kernels generated in voice.c, one per (layer oscillators, filter) combination of instrument_signatures
+// A voice whose render plan matches an entry renders oscillators, filter and envelope in one branch-free loop,
+// anything else (custom tones, noise layers) falls back to the generic per-layer path
+// Keep this in sync when adding instruments, synth_init warns about any instrument without an entry
+// Unused layer slots are NONE
+//
+// X(name, filter, layer0, layer1, layer2, layer3)
+//   filter: BIQUAD, BIQUAD2 (stages = 2), SVF (FILTER_TOPOLOGY_SVF) or NONE
+//   layer:  TABLE, BLEP_SQUARE, BLEP_SAWTOOTH, BLEP_TRIANGLE or NONE
+#define VOICE_KERNEL_LIST(X)                                                               \
+    X(lead_square, BIQUAD, BLEP_SQUARE, BLEP_SAWTOOTH, BLEP_SQUARE, BLEP_TRIANGLE)         \
+    X(metallic_pluck, BIQUAD, BLEP_SAWTOOTH, BLEP_SQUARE, BLEP_TRIANGLE, NONE)             \
+    X(table4_biquad, BIQUAD, TABLE, TABLE, TABLE, TABLE) /* ethereal pad, bell lead */    \
+    X(table3_biquad, BIQUAD, TABLE, TABLE, TABLE, NONE)  /* warm bass, deep drone */      \
+    X(table3_biquad2, BIQUAD2, TABLE, TABLE, TABLE, NONE) /* deep drone, stages = 2 */    \
+    X(table2_svf, SVF, TABLE, TABLE, NONE, NONE)         /* wobble bass */                \
+    X(table4, NONE, TABLE, TABLE, TABLE, TABLE)                                            \
+    X(table1, NONE, TABLE, NONE, NONE, NONE)
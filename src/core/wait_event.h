@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+typedef dispatch_semaphore_t wait_sem_t;
+#else
+#include "semaphore.h"
+typedef sem_t wait_sem_t;
+#endif
+
+#define WAIT_EVENT_SPIN 2000 // polls before a waiter goes to sleep
+
+// Single waiter wait/notify primitive
+// The waiter spins for a bounded time, then publishes the position it waits for and sleeps on a semaphore.
+// Notifiers only pay a fence and a load unless someone sleeps and the published target was reached
+typedef struct
+{
+    atomic_bool waiting;
+    _Atomic uint32_t target; // position the waiter needs before a wakeup is worth it
+    wait_sem_t sem;
+} WaitEvent;
+
+// condition the waiter is waiting for
+typedef bool (*WaitCond)(void *ctx);
+
+static inline void cpu_relax(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline void wait_event_init(WaitEvent *ev)
+{
+    atomic_init(&ev->waiting, false);
+    atomic_init(&ev->target, 0);
+#ifdef __APPLE__
+    ev->sem = dispatch_semaphore_create(0);
+#else
+    sem_init(&ev->sem, 0, 0);
+#endif
+}
+
+static inline void wait_event_destroy(WaitEvent *ev)
+{
+#ifdef __APPLE__
+    dispatch_release(ev->sem);
+#else
+    sem_destroy(&ev->sem);
+#endif
+}
+
+static inline void wait_event_sleep(WaitEvent *ev)
+{
+#ifdef __APPLE__
+    dispatch_semaphore_wait(ev->sem, DISPATCH_TIME_FOREVER);
+#else
+    while (sem_wait(&ev->sem) != 0)
+        ; // interrupted by a signal
+#endif
+}
+
+/**
+ * Wake the waiter unconditionally (state changes the target can not express, shutdown)
+ * @param ev Event to signal
+ */
+static inline void wait_event_wake(WaitEvent *ev)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange(&ev->waiting, false))
+    {
+#ifdef __APPLE__
+        dispatch_semaphore_signal(ev->sem);
+#else
+        sem_post(&ev->sem);
+#endif
+    }
+}
+
+/**
+ * Wake the waiter if the position it waits for has been reached
+ * @param ev Event to signal
+ * @param pos Position just published by the notifier
+ */
+static inline void wait_event_notify(WaitEvent *ev, uint32_t pos)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&ev->waiting, memory_order_relaxed))
+        return;
+    if ((int32_t)(pos - atomic_load_explicit(&ev->target, memory_order_relaxed)) < 0)
+        return;
+
+    wait_event_wake(ev);
+}
+
+/**
+ * Block until cond(ctx) holds, short bounded spin first
+ * @param ev Event the notifier signals
+ * @param target Position that makes a notification worth waking up for
+ * @param cond Condition to wait for, re-checked after every wakeup
+ * @param ctx Context passed to cond
+ */
+static inline void wait_event_wait(WaitEvent *ev, uint32_t target, WaitCond cond, void *ctx)
+{
+    for (int i = 0; i < WAIT_EVENT_SPIN; i++)
+    {
+        if (cond(ctx))
+            return;
+        cpu_relax();
+    }
+
+    for (;;)
+    {
+        atomic_store_explicit(&ev->target, target, memory_order_relaxed);
+        atomic_store(&ev->waiting, true);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        // re-check after announcing, a notifier that came earlier did not see us
+        if (cond(ctx))
+        {
+            atomic_store(&ev->waiting, false);
+            return;
+        }
+
+        wait_event_sleep(ev);
+
+        if (cond(ctx))
+            return;
+    }
+}
@@ -1,9 +1,29 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "../oscillators/oscillators.h"
 #include "qsynth.h"
 
+typedef enum
+{
+    WAVE_OSC_TABLE = 0, // mipmapped bandlimited wavetable
+    WAVE_OSC_POLYBLEP,  // analytic with polyblep/polyblamp corrections, square/sawtooth/triangle only
+} WaveOsc;
+
 typedef struct
 {
     WaveType type;
+    WaveOsc osc; // oscillator implementation, waveforms without a polyblep variant use the table
 } Wave;
+
+static inline bool wave_is_noise(const Wave *wave)
+{
+    return wave->type == WAVE_NOISE || wave->type == WAVE_PINK_NOISE || wave->type == WAVE_BROWN_NOISE;
+}
+
+static inline bool wave_is_polyblep(const Wave *wave)
+{
+    return wave->osc == WAVE_OSC_POLYBLEP &&
+           (wave->type == WAVE_SQUARE || wave->type == WAVE_SAWTOOTH || wave->type == WAVE_TRIANGLE);
+}
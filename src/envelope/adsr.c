@@ -1,21 +1,91 @@
 #include "adsr.h"
 #include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <limits.h>
 
-void adsr_init(ADSREnvelope *env, const EnvelopeCfg *cfg)
+// precompute a segment from the current level to end over time seconds, at least one sample
+// the slope follows the exact length, the last sample of a fractional length snaps to the end
+static void adsr_ramp(ADSREnvelope *env, double end, double time, EnvelopeCurve curve, double ratio)
+{
+    double length = time * env->sample_rate;
+    length = length < 1.0 ? 1.0 : length;
+
+    // tolerate the rounding of time * rate, 0.01 s at 44.1 kHz is 441 samples and not 442
+    double samples = ceil(length - 1e-6);
+    int count = samples > INT_MAX ? INT_MAX : (int)samples;
+    double start = env->current_level;
+
+    env->remaining = count;
+    env->end_level = end;
+
+    if (curve == ENVELOPE_EXPONENTIAL && start != end)
+    {
+        // asymptote past the end, the level reaches end after length samples
+        double asymptote = end + ratio * (end - start);
+        env->coef = pow(ratio / (1.0 + ratio), 1.0 / length);
+        env->offset = asymptote * (1.0 - env->coef);
+    }
+    else
+    {
+        env->coef = 1.0;
+        env->offset = (end - start) / length;
+    }
+}
+
+static void adsr_enter(ADSREnvelope *env, ADSRState state)
+{
+    env->state = state;
+
+    switch (state)
+    {
+    case ADSR_ATTACK:
+        adsr_ramp(env, 1.0, env->cfg.attack_time, env->cfg.attack_curve, ADSR_ATTACK_RATIO);
+        break;
+    case ADSR_DECAY:
+        adsr_ramp(env, env->cfg.sustain_level, env->cfg.decay_time, env->cfg.decay_curve, ADSR_DECAY_RATIO);
+        break;
+    case ADSR_RELEASE:
+        adsr_ramp(env, 0.0, env->cfg.release_time, env->cfg.release_curve, ADSR_DECAY_RATIO);
+        break;
+    case ADSR_SUSTAIN:
+        env->current_level = env->cfg.sustain_level;
+        env->remaining = 0;
+        break;
+    case ADSR_IDLE:
+        env->current_level = 0.0;
+        env->remaining = 0;
+        break;
+    }
+}
+
+// last sample of a segment lands exactly on its end level
+static void adsr_finish_segment(ADSREnvelope *env)
+{
+    env->current_level = env->end_level;
+
+    switch (env->state)
+    {
+    case ADSR_ATTACK:
+        adsr_enter(env, ADSR_DECAY);
+        break;
+    case ADSR_DECAY:
+        adsr_enter(env, ADSR_SUSTAIN);
+        break;
+    default:
+        adsr_enter(env, ADSR_IDLE);
+        break;
+    }
+}
+
+void adsr_init(ADSREnvelope *env, const EnvelopeCfg *cfg, double sample_rate)
 {
     if (!env || !cfg)
         return;
 
-    env->state = ADSR_IDLE;
-    env->current_level = 0.0;
-    env->target_level = 0.0;
-    env->rate = 0.0;
-    env->sustain_level = cfg->sustain_level;
-    env->attack_time = cfg->attack_time;
-    env->decay_time = cfg->decay_time;
-    env->release_time = cfg->release_time;
-    env->time_in_state = 0.0;
-    env->note_is_on = 0;
+    env->cfg = *cfg;
+    env->sample_rate = sample_rate;
+    adsr_reset(env);
 }
 
 void adsr_reset(ADSREnvelope *env)
@@ -25,10 +95,10 @@ void adsr_reset(ADSREnvelope *env)
 
     env->state = ADSR_IDLE;
     env->current_level = 0.0;
-    env->target_level = 0.0;
-    env->rate = 0.0;
-    env->time_in_state = 0.0;
-    env->note_is_on = 0;
+    env->remaining = 0;
+    env->coef = 1.0;
+    env->offset = 0.0;
+    env->end_level = 0.0;
 }
 
 void adsr_note_on(ADSREnvelope *env)
@@ -36,21 +106,8 @@ void adsr_note_on(ADSREnvelope *env)
     if (!env)
         return;
 
-    env->note_is_on = 1;
-    env->state = ADSR_ATTACK;
-    env->target_level = 1.0;
-    env->time_in_state = 0.0;
-
-    // Calculate attack rate
-    if (env->attack_time > 0.0)
-    {
-        env->rate = (env->target_level - env->current_level) / env->attack_time;
-    }
-    else
-    {
-        env->current_level = env->target_level;
-        env->rate = 0.0;
-    }
+    // from the current level, a retrigger does not click
+    adsr_enter(env, ADSR_ATTACK);
 }
 
 void adsr_note_off(ADSREnvelope *env)
@@ -58,136 +115,68 @@ void adsr_note_off(ADSREnvelope *env)
     if (!env)
         return;
 
-    env->note_is_on = 0;
-    env->state = ADSR_RELEASE;
-    env->target_level = 0.0;
-    env->time_in_state = 0.0;
-
-    // Calculate release rate
-    if (env->release_time > 0.0)
-    {
-        env->rate = (env->target_level - env->current_level) / env->release_time;
-    }
-    else
-    {
-        env->current_level = env->target_level;
-        env->rate = 0.0;
-    }
+    adsr_enter(env, ADSR_RELEASE);
 }
 
-double adsr_process(ADSREnvelope *env, double delta_time)
+double adsr_process(ADSREnvelope *env)
 {
     if (!env)
         return 0.0;
 
-    env->time_in_state += delta_time;
+    if (env->remaining == 0)
+        return env->current_level;
 
-    switch (env->state)
+    if (--env->remaining == 0)
     {
-    case ADSR_IDLE:
-        env->current_level = 0.0;
-        break;
+        double level = env->end_level;
+        adsr_finish_segment(env);
+        return level;
+    }
 
-    case ADSR_ATTACK:
-        if (env->attack_time <= 0.0)
-        {
-            // Instant attack
-            env->current_level = 1.0;
-            env->state = ADSR_DECAY;
-            env->target_level = env->sustain_level;
-            env->time_in_state = 0.0;
-
-            if (env->decay_time > 0.0)
-            {
-                env->rate = (env->target_level - env->current_level) / env->decay_time;
-            }
-            else
-            {
-                env->current_level = env->target_level;
-                env->rate = 0.0;
-            }
-        }
-        else
-        {
-            // Linear attack
-            env->current_level += env->rate * delta_time;
-
-            if (env->current_level >= 1.0)
-            {
-                env->current_level = 1.0;
-                env->state = ADSR_DECAY;
-                env->target_level = env->sustain_level;
-                env->time_in_state = 0.0;
-
-                if (env->decay_time > 0.0)
-                {
-                    env->rate = (env->target_level - env->current_level) / env->decay_time;
-                }
-                else
-                {
-                    env->current_level = env->target_level;
-                    env->rate = 0.0;
-                }
-            }
-        }
-        break;
+    env->current_level = env->current_level * env->coef + env->offset;
+    return env->current_level;
+}
 
-    case ADSR_DECAY:
-        if (env->decay_time <= 0.0)
-        {
-            // Instant decay
-            env->current_level = env->sustain_level;
-            env->state = ADSR_SUSTAIN;
-            env->rate = 0.0;
-        }
-        else
+void adsr_render_block(ADSREnvelope *env, qsample *out, int stride, int frames)
+{
+    while (frames > 0)
+    {
+        double level = env->current_level;
+
+        // sustain and idle hold their level for the rest of the block
+        if (env->remaining == 0)
         {
-            // Linear decay
-            env->current_level += env->rate * delta_time;
-
-            if (env->current_level <= env->sustain_level)
-            {
-                env->current_level = env->sustain_level;
-                env->state = ADSR_SUSTAIN;
-                env->rate = 0.0;
-            }
+            for (int i = 0; i < frames; i++)
+                out[i * stride] = (qsample)level;
+            return;
         }
-        break;
 
-    case ADSR_SUSTAIN:
-        env->current_level = env->sustain_level;
-        break;
+        bool ends = env->remaining <= frames;
+        int steps = ends ? env->remaining - 1 : frames;
+        double coef = env->coef;
+        double offset = env->offset;
 
-    case ADSR_RELEASE:
-        if (env->release_time <= 0.0)
+        for (int i = 0; i < steps; i++)
         {
-            // Instant release
-            env->current_level = 0.0;
-            env->state = ADSR_IDLE;
-            env->rate = 0.0;
+            level = level * coef + offset;
+            out[i * stride] = (qsample)level;
         }
-        else
+        env->current_level = level;
+        out += steps * stride;
+        frames -= steps;
+
+        if (!ends)
         {
-            // Linear release
-            env->current_level += env->rate * delta_time;
-
-            if (env->current_level <= 0.0)
-            {
-                env->current_level = 0.0;
-                env->state = ADSR_IDLE;
-                env->rate = 0.0;
-            }
+            env->remaining -= steps;
+            return;
         }
-        break;
-    }
-
-    // Clamp output to valid range
-    if (env->current_level < 0.0)
-        env->current_level = 0.0;
-    if (env->current_level > 1.0)
-        env->current_level = 1.0;
 
-    return env->current_level;
+        *out = (qsample)env->end_level;
+        out += stride;
+        frames--;
+        env->remaining = 0;
+        adsr_finish_segment(env);
+    }
 }
 
 int adsr_is_active(const ADSREnvelope *env)
@@ -1,5 +1,10 @@
 #pragma once
 
+#include "../utils/sample.h"
+
+#define ADSR_ATTACK_RATIO 0.3   // exponential attack aims this far past 1 (of the segment span), a soft knee at the top
+#define ADSR_DECAY_RATIO 0.001  // exponential decay/release aim this far below their end, close to a true exponential
+
 typedef enum
 {
     ADSR_IDLE,
@@ -9,31 +14,50 @@ typedef enum
     ADSR_RELEASE
 } ADSRState;
 
+typedef enum
+{
+    ENVELOPE_LINEAR = 0,
+    ENVELOPE_EXPONENTIAL, // RC style, fast start and a slow tail, still ends exactly on time
+} EnvelopeCurve;
+
 typedef struct
 {
     double attack_time;   // Attack time in seconds
     double decay_time;    // Decay time in seconds
     double sustain_level; // Sustain level (0.0 to 1.0)
     double release_time;  // Release time in seconds
+    EnvelopeCurve attack_curve;  // shape of each segment, linear if left out
+    EnvelopeCurve decay_curve;
+    EnvelopeCurve release_curve;
 } EnvelopeCfg;
 
+// Every segment is precomputed at its start as a sample count and level = level * coef + offset
+// Linear segments have coef 1, exponential ones approach an asymptote past the end level
 typedef struct
 {
     ADSRState state;
     double current_level;
-    double target_level;
-    double rate;
-    double sustain_level;
-    double attack_time;
-    double decay_time;
-    double release_time;
-    double time_in_state;
-    int note_is_on;
+    int remaining;     // samples left in the segment, 0 holds the level (sustain, idle)
+    double coef;
+    double offset;
+    double end_level;  // exact level of the last sample of the segment
+    double sample_rate;
+    EnvelopeCfg cfg;
 } ADSREnvelope;
 
-void adsr_init(ADSREnvelope *env, const EnvelopeCfg *cfg);
+void adsr_init(ADSREnvelope *env, const EnvelopeCfg *cfg, double sample_rate);
 void adsr_reset(ADSREnvelope *env);
 void adsr_note_on(ADSREnvelope *env);
 void adsr_note_off(ADSREnvelope *env);
-double adsr_process(ADSREnvelope *env, double delta_time);
-int adsr_is_active(const ADSREnvelope *env);
\ No newline at end of file
+double adsr_process(ADSREnvelope *env);
+
+/**
+ * Advance the envelope by a block, branches only at segment boundaries
+ * @param env Envelope to advance
+ * @param out Receives the level of each frame
+ * @param stride Distance between two frames in out
+ * @param frames Frames to render
+ */
+void adsr_render_block(ADSREnvelope *env, qsample *out, int stride, int frames);
+
+int adsr_is_active(const ADSREnvelope *env);
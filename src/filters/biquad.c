@@ -3,18 +3,19 @@
 #include <string.h>
 
 #include "../utils/constant.h"
+#include "../utils/fastmath.h"
 
-static void calculate_coefficients(BiquadFilter* filter, double sample_rate) {
-    if (filter->cfg.filter_type == FILTER_NONE) return;
+void biquad_design(BiquadCoeffs* coeffs, const FilterCfg* cfg, double sample_rate) {
+    if (cfg->filter_type == FILTER_NONE) return;
     
-    double omega = 2.0 * M_PI * filter->cfg.cutoff / sample_rate;
-    double sin_omega = sin(omega);
-    double cos_omega = cos(omega);
-    double alpha = sin_omega / (2.0 * filter->cfg.resonance);
+    double omega = 2.0 * M_PI * cfg->cutoff / sample_rate;
+    double sin_omega = fastmath_sin(omega);
+    double cos_omega = fastmath_cos(omega);
+    double alpha = sin_omega / (2.0 * cfg->resonance);
     
     double a0_unnorm, a1, a2, b0, b1, b2;
     
-    switch (filter->cfg.filter_type) {
+    switch (cfg->filter_type) {
         case FILTER_LOWPASS:
             b0 = (1.0 - cos_omega) / 2.0;
             b1 = 1.0 - cos_omega;
@@ -56,60 +57,131 @@ static void calculate_coefficients(BiquadFilter* filter, double sample_rate) {
     }
     
     // Normalize coefficients
-    filter->a0 = b0 / a0_unnorm;
-    filter->a1 = b1 / a0_unnorm;
-    filter->a2 = b2 / a0_unnorm;
-    filter->b1 = a1 / a0_unnorm;
-    filter->b2 = a2 / a0_unnorm;
+    coeffs->a0 = (qsample)(b0 / a0_unnorm);
+    coeffs->a1 = (qsample)(b1 / a0_unnorm);
+    coeffs->a2 = (qsample)(b2 / a0_unnorm);
+    coeffs->b1 = (qsample)(a1 / a0_unnorm);
+    coeffs->b2 = (qsample)(a2 / a0_unnorm);
+}
+
+const BiquadCoeffs* biquad_cache_get(BiquadCache* cache, const FilterCfg* cfg, double sample_rate) {
+    if (cfg->filter_type == FILTER_NONE) return NULL;
+
+    for (int i = 0; i < cache->n; i++) {
+        BiquadCacheEntry* entry = &cache->entries[i];
+        if (entry->cfg.filter_type == cfg->filter_type && entry->cfg.cutoff == cfg->cutoff &&
+            entry->cfg.resonance == cfg->resonance && entry->sample_rate == sample_rate)
+            return &entry->coeffs;
+    }
+
+    if (cache->n == BIQUAD_CACHE_SIZE) return NULL;
+
+    BiquadCacheEntry* entry = &cache->entries[cache->n++];
+    entry->cfg = *cfg;
+    entry->sample_rate = sample_rate;
+    biquad_design(&entry->coeffs, cfg, sample_rate);
+    return &entry->coeffs;
 }
 
-void biquad_init(BiquadFilter* filter, const FilterCfg *cfg, double sample_rate) {
-    memset(filter, 0, sizeof(BiquadFilter));
-    filter->cfg = *cfg; 
+// no trig, the coefficients were designed for the same cfg beforehand
+void biquad_init(BiquadFilter* filter, const FilterCfg* cfg, const BiquadCoeffs* coeffs) {
+    filter->cfg = *cfg;
+    filter->coeffs = coeffs;
     biquad_reset(filter);
-    calculate_coefficients(filter, sample_rate);
 }
 
 void biquad_reset(BiquadFilter* filter) {
-    filter->x1 = filter->x2 = 0.0;
-    filter->y1 = filter->y2 = 0.0;
+    memset(filter->s1, 0, sizeof(filter->s1));
+    memset(filter->s2, 0, sizeof(filter->s2));
 }
 
-double biquad_process(BiquadFilter* filter, double input) {
+qsample biquad_process(BiquadFilter* filter, qsample input) {
     if (filter->cfg.filter_type == FILTER_NONE) return input;
     
-    double output = filter->a0 * input + 
-                   filter->a1 * filter->x1 + 
-                   filter->a2 * filter->x2 -
-                   filter->b1 * filter->y1 - 
-                   filter->b2 * filter->y2;
-    
-    // Shift delay lines
-    filter->x2 = filter->x1;
-    filter->x1 = input;
-    filter->y2 = filter->y1;
-    filter->y1 = output;
+    const BiquadCoeffs* c = filter->coeffs;
+    int stages = biquad_stages(&filter->cfg);
+
+    for (int st = 0; st < stages; st++) {
+        qsample output = c->a0 * input + filter->s1[st];
+        filter->s1[st] = c->a1 * input + filter->s2[st] - c->b1 * output;
+        filter->s2[st] = c->a2 * input - c->b2 * output;
+        input = output;
+    }
     
-    return output;
+    return input;
 }
 
-void biquad_set_cutoff(BiquadFilter* filter, double cutoff, double sample_rate) {
-    if (filter->cfg.cutoff != cutoff) {
-        filter->cfg.cutoff = cutoff;
-        calculate_coefficients(filter, sample_rate);
+void biquad_process_block(BiquadFilter* filter, qsample* buf, int frames) {
+    if (filter->cfg.filter_type == FILTER_NONE) return;
+
+    // keep coefficients and state in registers for the whole block, one pass per section
+    qsample a0 = filter->coeffs->a0, a1 = filter->coeffs->a1, a2 = filter->coeffs->a2;
+    qsample b1 = filter->coeffs->b1, b2 = filter->coeffs->b2;
+    int stages = biquad_stages(&filter->cfg);
+
+    for (int st = 0; st < stages; st++) {
+        qsample s1 = filter->s1[st], s2 = filter->s2[st];
+
+        for (int i = 0; i < frames; i++) {
+            qsample input = buf[i];
+            qsample output = a0 * input + s1;
+            s1 = a1 * input + s2 - b1 * output;
+            s2 = a2 * input - b2 * output;
+            buf[i] = output;
+        }
+
+        filter->s1[st] = s1;
+        filter->s2[st] = s2;
     }
 }
 
-void biquad_set_resonance(BiquadFilter* filter, double resonance, double sample_rate) {
-    if (filter->cfg.resonance != resonance) {
-        filter->cfg.resonance = resonance;
-        calculate_coefficients(filter, sample_rate);
-    }
+void biquad_sweep_start(BiquadSweep* sweep, BiquadFilter* filter, double cutoff, double sample_rate) {
+    memset(sweep, 0, sizeof(BiquadSweep));
+    filter->cfg.cutoff = cutoff;
+    biquad_design(&sweep->coeffs, &filter->cfg, sample_rate);
+    filter->coeffs = &sweep->coeffs;
+}
+
+void biquad_sweep_to(BiquadSweep* sweep, BiquadFilter* filter, double cutoff, int frames, double sample_rate) {
+    if (filter->cfg.filter_type == FILTER_NONE || frames <= 0) return;
+
+    // the step starts from where the last ramp ended, rounding never adds up over more than one tick
+    BiquadCoeffs target = sweep->coeffs;
+    filter->cfg.cutoff = cutoff;
+    biquad_design(&target, &filter->cfg, sample_rate);
+
+    qsample inv = (qsample)1.0 / (qsample)frames;
+    sweep->step.a0 = (target.a0 - sweep->coeffs.a0) * inv;
+    sweep->step.a1 = (target.a1 - sweep->coeffs.a1) * inv;
+    sweep->step.a2 = (target.a2 - sweep->coeffs.a2) * inv;
+    sweep->step.b1 = (target.b1 - sweep->coeffs.b1) * inv;
+    sweep->step.b2 = (target.b2 - sweep->coeffs.b2) * inv;
 }
 
-void biquad_set_type(BiquadFilter* filter, FilterType type, double sample_rate) {
-    if (filter->cfg.resonance != type) {
-        filter->cfg.resonance = type;
-        calculate_coefficients(filter, sample_rate);
+void biquad_process_block_sweep(BiquadFilter* filter, BiquadSweep* sweep, qsample* buf, int frames) {
+    if (filter->cfg.filter_type == FILTER_NONE || frames <= 0) return;
+
+    // five adds per frame instead of a design, every section of the cascade uses the same ramp
+    BiquadCoeffs c = sweep->coeffs;
+    const BiquadCoeffs d = sweep->step;
+    int stages = biquad_stages(&filter->cfg);
+
+    for (int i = 0; i < frames; i++) {
+        qsample input = buf[i];
+        for (int st = 0; st < stages; st++) {
+            qsample output = c.a0 * input + filter->s1[st];
+            filter->s1[st] = c.a1 * input + filter->s2[st] - c.b1 * output;
+            filter->s2[st] = c.a2 * input - c.b2 * output;
+            input = output;
+        }
+        buf[i] = input;
+
+        c.a0 += d.a0;
+        c.a1 += d.a1;
+        c.a2 += d.a2;
+        c.b1 += d.b1;
+        c.b2 += d.b2;
     }
+
+    sweep->coeffs = c;
 }
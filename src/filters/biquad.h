@@ -1,6 +1,7 @@
 #pragma once
 
 #include "qsynth.h"
+#include "../utils/sample.h"
 
 typedef enum {
     FILTER_LOWPASS = 0,
@@ -11,28 +12,117 @@ typedef enum {
 } FilterType;
 
 
+#define BIQUAD_MAX_STAGES 4
+
+typedef enum {
+    FILTER_TOPOLOGY_BIQUAD = 0, // RBJ biquad, transposed direct form II
+    FILTER_TOPOLOGY_SVF,        // trapezoidal state variable filter (svf.h), same response, cheap cutoff changes
+} FilterTopology;
+
 typedef struct {
     FilterType filter_type;
     double cutoff;
     double resonance;
+    FilterTopology topology; // biquad unless set
+    int stages;              // identical biquad sections in series, 0 or 1 = 12 dB/oct, 2 = 24 dB/oct, up to BIQUAD_MAX_STAGES
 } FilterCfg;
 
+static inline int biquad_stages(const FilterCfg *cfg)
+{
+    return cfg->stages < 1 ? 1 : cfg->stages > BIQUAD_MAX_STAGES ? BIQUAD_MAX_STAGES : cfg->stages;
+}
+
+// Coefficients, designed in double and stored at the precision of the audio path
+typedef struct
+{
+    qsample a0, a1, a2; // Feedforward
+    qsample b1, b2;     // Feedback
+} BiquadCoeffs;
+
 typedef struct
 {
-    // Coefficients
-    double a0, a1, a2; // Feedforward
-    double b1, b2;     // Feedback
+    const BiquadCoeffs *coeffs; // shared from a BiquadCache, or the coefficients of a BiquadSweep
 
-    double x1, x2; // Input history
-    double y1, y2; // Output history
+    // transposed direct form II state of each section
+    qsample s1[BIQUAD_MAX_STAGES];
+    qsample s2[BIQUAD_MAX_STAGES];
 
     FilterCfg cfg;
 } BiquadFilter;
 
+// Coefficients a filter designs itself, when its cutoff is modulated or its configuration missed the cache
+// A sweep designs once per control tick and moves linearly from design to design in between; the stable
+// region of (b1, b2) is convex, so every frame between two stable designs is stable too
+typedef struct
+{
+    BiquadCoeffs coeffs; // current frame, the filter points here
+    BiquadCoeffs step;   // added every frame until the next design
+} BiquadSweep;
+
+#define BIQUAD_CACHE_SIZE 32
+
+typedef struct
+{
+    FilterCfg cfg; // topology and stages are not part of the key, every section shares the coefficients
+    double sample_rate;
+    BiquadCoeffs coeffs;
+} BiquadCacheEntry;
+
+// Coefficients of static filter configurations, designed once and shared by every filter that uses them
+// Not thread safe, fill and read it from one thread; entries never move, so handed out pointers stay valid
+typedef struct
+{
+    BiquadCacheEntry entries[BIQUAD_CACHE_SIZE];
+    int n;
+} BiquadCache;
+
+/**
+ * Find the coefficients of a configuration, designing them on first use
+ * @param cache Cache to search and fill
+ * @param cfg Filter type, cutoff and resonance
+ * @param sample_rate Sample rate in Hz
+ * @return Shared coefficients, NULL for FILTER_NONE or when the cache is full
+ */
+const BiquadCoeffs *biquad_cache_get(BiquadCache *cache, const FilterCfg *cfg, double sample_rate);
+
+/**
+ * Design the coefficients of a configuration, one section, the sections of a cascade share them
+ * @param coeffs Coefficients to write, left untouched for FILTER_NONE
+ * @param cfg Filter type, cutoff and resonance
+ * @param sample_rate Sample rate in Hz
+ */
+void biquad_design(BiquadCoeffs *coeffs, const FilterCfg *cfg, double sample_rate);
+
 // Filter functions
-void biquad_init(BiquadFilter* filter, const FilterCfg *cfg, double sample_rate);
+void biquad_init(BiquadFilter *filter, const FilterCfg *cfg, const BiquadCoeffs *coeffs);
 void biquad_reset(BiquadFilter *filter);
-double biquad_process(BiquadFilter *filter, double input);
-void biquad_set_cutoff(BiquadFilter *filter, double cutoff, double sample_rate);
-void biquad_set_resonance(BiquadFilter *filter, double resonance, double sample_rate);
-void biquad_set_type(BiquadFilter *filter, FilterType type, double sample_rate);
+qsample biquad_process(BiquadFilter *filter, qsample input);
+void biquad_process_block(BiquadFilter *filter, qsample *buf, int frames);
+
+/**
+ * Design the coefficients of a cutoff and point the filter at them, no ramp until biquad_sweep_to
+ * @param sweep Coefficient storage of the filter
+ * @param filter Filter to follow the sweep, keeps its type and resonance
+ * @param cutoff Cutoff in Hz
+ * @param sample_rate Sample rate in Hz
+ */
+void biquad_sweep_start(BiquadSweep *sweep, BiquadFilter *filter, double cutoff, double sample_rate);
+
+/**
+ * Design the coefficients of the next control tick, the sweep reaches them after the given frames
+ * @param sweep Sweep started by biquad_sweep_start
+ * @param filter Filter following the sweep
+ * @param cutoff Cutoff in Hz at the end of the ramp
+ * @param frames Frames until the next tick
+ * @param sample_rate Sample rate in Hz
+ */
+void biquad_sweep_to(BiquadSweep *sweep, BiquadFilter *filter, double cutoff, int frames, double sample_rate);
+
+/**
+ * Filter a block while the coefficients ramp towards the last design of the sweep
+ * @param filter Filter following the sweep
+ * @param sweep Coefficients, advanced by one step per frame
+ * @param buf Samples, filtered in place
+ * @param frames Frames to filter, at most the frames left until the next tick
+ */
+void biquad_process_block_sweep(BiquadFilter *filter, BiquadSweep *sweep, qsample *buf, int frames);
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string.h>
+
+#include "biquad.h"
+
+// Independent biquads side by side, one filter per vector lane (voices of a group, channels of a bus)
+// A biquad is a recurrence and cannot vectorize in time, across filters every lane is free
+// Same transposed direct form II as biquad_process, so a lane and the scalar filter agree
+#define BIQUAD_LANES ((int)(64 / sizeof(qsample))) // one AVX-512 vector, 8 double or 16 float lanes
+
+typedef qsample biquad_lanes_qs __attribute__((vector_size(BIQUAD_LANES * sizeof(qsample))));
+
+// structure of arrays, every section of a lane shares its coefficients
+typedef struct
+{
+    qsample a0[BIQUAD_LANES], a1[BIQUAD_LANES], a2[BIQUAD_LANES];
+    qsample b1[BIQUAD_LANES], b2[BIQUAD_LANES];
+    qsample s1[BIQUAD_MAX_STAGES][BIQUAD_LANES];
+    qsample s2[BIQUAD_MAX_STAGES][BIQUAD_LANES];
+} BiquadLanes;
+
+// register copy for the length of a block, stages is a constant at every call site
+typedef struct
+{
+    biquad_lanes_qs a0, a1, a2, b1, b2;
+    biquad_lanes_qs s1[BIQUAD_MAX_STAGES], s2[BIQUAD_MAX_STAGES];
+} BiquadLanesRegs;
+
+static inline __attribute__((always_inline)) void biquad_lanes_load(BiquadLanesRegs *regs, const BiquadLanes *lanes,
+                                                                    const int stages)
+{
+    memcpy(&regs->a0, lanes->a0, sizeof(biquad_lanes_qs));
+    memcpy(&regs->a1, lanes->a1, sizeof(biquad_lanes_qs));
+    memcpy(&regs->a2, lanes->a2, sizeof(biquad_lanes_qs));
+    memcpy(&regs->b1, lanes->b1, sizeof(biquad_lanes_qs));
+    memcpy(&regs->b2, lanes->b2, sizeof(biquad_lanes_qs));
+    for (int st = 0; st < stages; st++)
+    {
+        memcpy(&regs->s1[st], lanes->s1[st], sizeof(biquad_lanes_qs));
+        memcpy(&regs->s2[st], lanes->s2[st], sizeof(biquad_lanes_qs));
+    }
+}
+
+static inline __attribute__((always_inline)) void biquad_lanes_store(const BiquadLanesRegs *regs, BiquadLanes *lanes,
+                                                                     const int stages)
+{
+    for (int st = 0; st < stages; st++)
+    {
+        memcpy(lanes->s1[st], &regs->s1[st], sizeof(biquad_lanes_qs));
+        memcpy(lanes->s2[st], &regs->s2[st], sizeof(biquad_lanes_qs));
+    }
+}
+
+/**
+ * Filter one frame of every lane through the cascade
+ * The only feedback is output -> s1 -> next output, one multiply-add per section and frame
+ * @param regs Coefficients and state from biquad_lanes_load
+ * @param sample One sample per lane, filtered in place (vectors go by pointer, returning them is ABI dependent)
+ * @param stages Sections in series, 1 to BIQUAD_MAX_STAGES
+ */
+static inline __attribute__((always_inline)) void biquad_lanes_step(BiquadLanesRegs *regs, biquad_lanes_qs *sample,
+                                                                    const int stages)
+{
+    biquad_lanes_qs input = *sample;
+    for (int st = 0; st < stages; st++)
+    {
+        biquad_lanes_qs output = regs->a0 * input + regs->s1[st];
+        regs->s1[st] = regs->a1 * input + regs->s2[st] - regs->b1 * output;
+        regs->s2[st] = regs->a2 * input - regs->b2 * output;
+        input = output;
+    }
+    *sample = input;
+}
+
+/**
+ * Filter a frame major block in place, lane l of frame i at buf[i][l]
+ * @param lanes Coefficients and state, the state is advanced
+ * @param buf Samples of every lane
+ * @param frames Frames to filter
+ * @param stages Sections in series, 1 to BIQUAD_MAX_STAGES
+ */
+static inline __attribute__((always_inline)) void biquad_lanes_process(BiquadLanes *lanes,
+                                                                       qsample (*buf)[BIQUAD_LANES], int frames,
+                                                                       const int stages)
+{
+    BiquadLanesRegs regs;
+    biquad_lanes_load(&regs, lanes, stages);
+
+    for (int i = 0; i < frames; i++)
+    {
+        biquad_lanes_qs s;
+        memcpy(&s, buf[i], sizeof(s));
+        biquad_lanes_step(&regs, &s, stages);
+        memcpy(buf[i], &s, sizeof(s));
+    }
+
+    biquad_lanes_store(&regs, lanes, stages);
+}
@@ -0,0 +1,176 @@
+#include "svf.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "../utils/constant.h"
+
+// tan(pi * x) at x = i / (2 * SVF_TAN_SIZE), linear interpolation is within 3e-5 relative up to SVF_CUTOFF_MAX
+static double svf_tan_table[SVF_TAN_SIZE];
+static bool svf_tables_ready = false;
+
+void svf_tables_init(void)
+{
+    if (svf_tables_ready)
+        return;
+
+    for (int i = 0; i < SVF_TAN_SIZE; i++)
+        svf_tan_table[i] = tan(M_PI * i / (2.0 * SVF_TAN_SIZE));
+
+    svf_tables_ready = true;
+}
+
+static inline double svf_lookup_g(double cutoff, double inv_sample_rate)
+{
+    double x = cutoff * inv_sample_rate;
+    x = x < SVF_CUTOFF_MIN * inv_sample_rate ? SVF_CUTOFF_MIN * inv_sample_rate : x;
+    x = x > SVF_CUTOFF_MAX ? SVF_CUTOFF_MAX : x;
+
+    double pos = x * (2.0 * SVF_TAN_SIZE);
+    int index = (int)pos;
+    double frac = pos - index;
+    return svf_tan_table[index] + frac * (svf_tan_table[index + 1] - svf_tan_table[index]);
+}
+
+static inline void svf_set_g(SvfFilter *filter, double g)
+{
+    double a1 = 1.0 / (1.0 + g * (g + filter->k));
+    filter->g = g;
+    filter->a1 = (qsample)a1;
+    filter->a2 = (qsample)(g * a1);
+    filter->a3 = (qsample)(g * g * a1);
+}
+
+// output mix of the configured response
+static void svf_set_mix(SvfFilter *filter)
+{
+    qsample k = (qsample)filter->k;
+
+    switch (filter->cfg.filter_type)
+    {
+    case FILTER_LOWPASS:
+        filter->m0 = 0.0, filter->m1 = 0.0, filter->m2 = 1.0;
+        break;
+    case FILTER_HIGHPASS:
+        filter->m0 = 1.0, filter->m1 = -k, filter->m2 = -1.0;
+        break;
+    case FILTER_BANDPASS:
+        filter->m0 = 0.0, filter->m1 = k, filter->m2 = 0.0;
+        break;
+    case FILTER_NOTCH:
+        filter->m0 = 1.0, filter->m1 = -k, filter->m2 = 0.0;
+        break;
+    default:
+        filter->m0 = 1.0, filter->m1 = 0.0, filter->m2 = 0.0;
+        break;
+    }
+}
+
+void svf_init(SvfFilter *filter, const FilterCfg *cfg, double sample_rate)
+{
+    memset(filter, 0, sizeof(SvfFilter));
+    filter->cfg = *cfg;
+    filter->inv_sample_rate = 1.0 / sample_rate;
+    filter->k = 1.0 / cfg->resonance;
+
+    svf_set_mix(filter);
+    svf_set_g(filter, svf_lookup_g(cfg->cutoff, filter->inv_sample_rate));
+}
+
+void svf_reset(SvfFilter *filter)
+{
+    filter->ic1eq = 0.0;
+    filter->ic2eq = 0.0;
+}
+
+void svf_set_cutoff(SvfFilter *filter, double cutoff)
+{
+    filter->cfg.cutoff = cutoff;
+    svf_set_g(filter, svf_lookup_g(cutoff, filter->inv_sample_rate));
+}
+
+void svf_process_outputs(SvfFilter *filter, qsample input, SvfOutputs *out)
+{
+    qsample v3 = input - filter->ic2eq;
+    qsample band = filter->a1 * filter->ic1eq + filter->a2 * v3;
+    qsample low = filter->ic2eq + filter->a2 * filter->ic1eq + filter->a3 * v3;
+    filter->ic1eq = 2 * band - filter->ic1eq;
+    filter->ic2eq = 2 * low - filter->ic2eq;
+
+    qsample k = (qsample)filter->k;
+    out->low = low;
+    out->band = k * band;
+    out->high = input - k * band - low;
+    out->notch = input - k * band;
+}
+
+qsample svf_process(SvfFilter *filter, qsample input)
+{
+    if (filter->cfg.filter_type == FILTER_NONE)
+        return input;
+
+    qsample v3 = input - filter->ic2eq;
+    qsample band = filter->a1 * filter->ic1eq + filter->a2 * v3;
+    qsample low = filter->ic2eq + filter->a2 * filter->ic1eq + filter->a3 * v3;
+    filter->ic1eq = 2 * band - filter->ic1eq;
+    filter->ic2eq = 2 * low - filter->ic2eq;
+
+    return filter->m0 * input + filter->m1 * band + filter->m2 * low;
+}
+
+void svf_process_block(SvfFilter *filter, qsample *buf, int frames)
+{
+    if (filter->cfg.filter_type == FILTER_NONE)
+        return;
+
+    // keep coefficients and state in registers for the whole block
+    qsample a1 = filter->a1, a2 = filter->a2, a3 = filter->a3;
+    qsample m0 = filter->m0, m1 = filter->m1, m2 = filter->m2;
+    qsample ic1eq = filter->ic1eq, ic2eq = filter->ic2eq;
+
+    for (int i = 0; i < frames; i++)
+    {
+        qsample input = buf[i];
+        qsample v3 = input - ic2eq;
+        qsample band = a1 * ic1eq + a2 * v3;
+        qsample low = ic2eq + a2 * ic1eq + a3 * v3;
+        ic1eq = 2 * band - ic1eq;
+        ic2eq = 2 * low - ic2eq;
+        buf[i] = m0 * input + m1 * band + m2 * low;
+    }
+
+    filter->ic1eq = ic1eq;
+    filter->ic2eq = ic2eq;
+}
+
+void svf_process_block_sweep(SvfFilter *filter, qsample *buf, const double *cutoff, int frames)
+{
+    if (filter->cfg.filter_type == FILTER_NONE || frames <= 0)
+        return;
+
+    double k = filter->k;
+    double inv_sample_rate = filter->inv_sample_rate;
+    qsample m0 = filter->m0, m1 = filter->m1, m2 = filter->m2;
+    qsample ic1eq = filter->ic1eq, ic2eq = filter->ic2eq;
+
+    for (int i = 0; i < frames; i++)
+    {
+        double g = svf_lookup_g(cutoff[i], inv_sample_rate);
+        double a1 = 1.0 / (1.0 + g * (g + k));
+        qsample a2 = (qsample)(g * a1);
+        qsample a3 = (qsample)(g * g * a1);
+
+        qsample input = buf[i];
+        qsample v3 = input - ic2eq;
+        qsample band = (qsample)a1 * ic1eq + a2 * v3;
+        qsample low = ic2eq + a2 * ic1eq + a3 * v3;
+        ic1eq = 2 * band - ic1eq;
+        ic2eq = 2 * low - ic2eq;
+        buf[i] = m0 * input + m1 * band + m2 * low;
+    }
+
+    filter->ic1eq = ic1eq;
+    filter->ic2eq = ic2eq;
+    svf_set_cutoff(filter, cutoff[frames - 1]);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "biquad.h"
+
+#define SVF_TAN_BITS 10
+#define SVF_TAN_SIZE (1 << SVF_TAN_BITS) // table points over cutoff / sample rate in [0, 0.5)
+#define SVF_CUTOFF_MAX 0.49              // of the sample rate, tan(pi x) grows without bound at nyquist
+#define SVF_CUTOFF_MIN 1.0               // Hz
+
+// Trapezoidal (TPT) state variable filter after Andrew Simper (Cytomic)
+// Low, band, high and notch come out of the same pass, the configured type picks a mix of them
+// Same responses as the biquad of the same FilterCfg, but the coefficients follow a cutoff change with one
+// table lookup and one division, and the state stays bounded under fast sweeps
+typedef struct
+{
+    // g = tan(pi * cutoff / sample_rate), k = 1 / resonance
+    double g;
+    double k;
+    qsample a1, a2, a3;
+
+    // output = m0 * input + m1 * band + m2 * low
+    qsample m0, m1, m2;
+
+    qsample ic1eq, ic2eq; // integrator states
+
+    double inv_sample_rate;
+    FilterCfg cfg;
+} SvfFilter;
+
+// every output of one pass
+typedef struct
+{
+    qsample low;
+    qsample band; // unity peak gain, like FILTER_BANDPASS
+    qsample high;
+    qsample notch;
+} SvfOutputs;
+
+// build the tan table, once before any filter is set up
+void svf_tables_init(void);
+
+void svf_init(SvfFilter *filter, const FilterCfg *cfg, double sample_rate);
+void svf_reset(SvfFilter *filter);
+
+/**
+ * Move the cutoff, cheap enough to call every sample
+ * @param filter Filter to retune
+ * @param cutoff Cutoff in Hz, clamped to [SVF_CUTOFF_MIN, SVF_CUTOFF_MAX * sample rate]
+ */
+void svf_set_cutoff(SvfFilter *filter, double cutoff);
+
+qsample svf_process(SvfFilter *filter, qsample input);
+
+/**
+ * Run one sample and return every response
+ * @param filter Filter to advance
+ * @param input Input sample
+ * @param out Receives low, band, high and notch
+ */
+void svf_process_outputs(SvfFilter *filter, qsample input, SvfOutputs *out);
+
+void svf_process_block(SvfFilter *filter, qsample *buf, int frames);
+
+/**
+ * Filter a block while the cutoff moves
+ * @param filter Filter to advance, ends on the last cutoff
+ * @param buf Samples, filtered in place
+ * @param cutoff Cutoff in Hz of each frame
+ * @param frames Frames to filter
+ */
+void svf_process_block_sweep(SvfFilter *filter, qsample *buf, const double *cutoff, int frames);
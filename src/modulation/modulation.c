@@ -0,0 +1,105 @@
+#include "modulation.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "../oscillators/wavetable.h"
+#include "../utils/constant.h"
+#include "../utils/fastmath.h"
+
+#define MOD_PHASE_TO_RADIANS (2.0 * M_PI / 4294967296.0)
+
+// LFO value of a DDS phase, -1 to 1
+static double mod_lfo_value(ModLfoShape shape, uint32_t phase)
+{
+    double signed_phase = (int32_t)phase * (1.0 / 2147483648.0); // -1 to 1, 0 at the start of the cycle
+
+    switch (shape)
+    {
+    case MOD_LFO_TRIANGLE:
+        return 1.0 - 2.0 * fabs(signed_phase);
+    case MOD_LFO_SQUARE:
+        return phase < 0x80000000u ? 1.0 : -1.0;
+    case MOD_LFO_SAWTOOTH:
+        return signed_phase;
+    default:
+        return fastmath_sin((int32_t)phase * MOD_PHASE_TO_RADIANS);
+    }
+}
+
+static double mod_source_value(const ModState *mod, ModSource source)
+{
+    switch (source)
+    {
+    case MOD_SRC_LFO1:
+        return mod_lfo_value(mod->cfg->lfo[0].shape, mod->lfo_phase[0]);
+    case MOD_SRC_LFO2:
+        return mod_lfo_value(mod->cfg->lfo[1].shape, mod->lfo_phase[1]);
+    case MOD_SRC_ENV:
+        return mod->env.current_level;
+    default:
+        return 0.0;
+    }
+}
+
+static void mod_evaluate(ModState *mod)
+{
+    memset(mod->value, 0, sizeof(mod->value));
+
+    for (int r = 0; r < MOD_ROUTE_MAX; r++)
+    {
+        const ModRoute *route = &mod->cfg->routes[r];
+        if (route->source != MOD_SRC_NONE)
+            mod->value[route->target] += mod_source_value(mod, route->source) * route->depth;
+    }
+}
+
+void mod_init(ModState *mod, const ModCfg *cfg, double sample_rate)
+{
+    memset(mod, 0, sizeof(*mod));
+    mod->cfg = cfg;
+
+    for (int r = 0; r < MOD_ROUTE_MAX; r++)
+    {
+        if (cfg->routes[r].source == MOD_SRC_NONE)
+            continue;
+        mod->route_n++;
+        mod->dst_mask |= 1u << cfg->routes[r].target;
+    }
+    if (mod->route_n == 0)
+        return;
+
+    double control_rate = sample_rate / MOD_CONTROL_RATE;
+    for (int l = 0; l < MOD_LFO_N; l++)
+    {
+        double offset = cfg->lfo[l].phase / 360.0;
+        mod->lfo_phase[l] = (uint32_t)((offset - floor(offset)) * 4294967296.0);
+        mod->lfo_inc[l] = wavetable_phase_increment(cfg->lfo[l].rate, control_rate);
+    }
+
+    adsr_init(&mod->env, &cfg->env, control_rate);
+    adsr_note_on(&mod->env);
+    adsr_process(&mod->env);
+
+    // the first tick has no history, start flat
+    mod_evaluate(mod);
+    memcpy(mod->prev, mod->value, sizeof(mod->prev));
+    mod->tick_left = MOD_CONTROL_RATE;
+}
+
+void mod_note_off(ModState *mod)
+{
+    if (mod->route_n)
+        adsr_note_off(&mod->env);
+}
+
+void mod_tick(ModState *mod)
+{
+    for (int l = 0; l < MOD_LFO_N; l++)
+        mod->lfo_phase[l] += mod->lfo_inc[l];
+    adsr_process(&mod->env);
+
+    memcpy(mod->prev, mod->value, sizeof(mod->prev));
+    mod_evaluate(mod);
+    mod->tick_left = MOD_CONTROL_RATE;
+}
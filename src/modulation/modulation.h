@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../envelope/adsr.h"
+
+#define MOD_CONTROL_RATE 32 // samples per control tick, 16, 32 or 64; targets ramp linearly between ticks
+#define MOD_LFO_N 2
+#define MOD_ROUTE_MAX 8
+
+typedef enum
+{
+    MOD_LFO_SINE = 0,
+    MOD_LFO_TRIANGLE,
+    MOD_LFO_SQUARE,
+    MOD_LFO_SAWTOOTH,
+} ModLfoShape;
+
+typedef struct
+{
+    ModLfoShape shape;
+    double rate;  // Hz
+    double phase; // start phase in degrees, every note restarts its LFOs
+} ModLfoCfg;
+
+typedef enum
+{
+    MOD_SRC_NONE = 0, // unused route
+    MOD_SRC_LFO1,     // bipolar, -1 to 1
+    MOD_SRC_LFO2,
+    MOD_SRC_ENV, // modulation envelope, 0 to 1, released with the note
+} ModSource;
+
+typedef enum
+{
+    MOD_DST_PITCH,  // semitones
+    MOD_DST_CUTOFF, // octaves around the filter cutoff of the tone
+    MOD_DST_AMP,    // gain offset around 1, clamped at 0
+    MOD_DST_PAN,    // added to the note pan, clamped to 0-1
+    MOD_DST_COUNT,
+} ModTarget;
+
+typedef struct
+{
+    ModSource source;
+    ModTarget target;
+    double depth; // target units at a source value of 1
+} ModRoute;
+
+// modulation matrix of a tone, all zero means no modulation and no cost
+typedef struct
+{
+    ModLfoCfg lfo[MOD_LFO_N];
+    EnvelopeCfg env;
+    ModRoute routes[MOD_ROUTE_MAX];
+} ModCfg;
+
+// Per voice state, sources are evaluated once per control tick
+typedef struct
+{
+    const ModCfg *cfg;
+    int route_n;        // routes with a source, 0 = the voice is not modulated
+    uint32_t dst_mask;  // 1 << ModTarget of every routed target
+    int tick_left;      // frames until the next control tick
+    uint32_t lfo_phase[MOD_LFO_N]; // DDS phases, advanced once per tick
+    uint32_t lfo_inc[MOD_LFO_N];
+    ADSREnvelope env; // runs at the control rate
+    double prev[MOD_DST_COUNT];  // target values at the previous tick
+    double value[MOD_DST_COUNT]; // target values at the last tick
+} ModState;
+
+/**
+ * Set up the modulation of a note, evaluates the first tick
+ * @param mod State to set up
+ * @param cfg Modulation matrix of the tone
+ * @param sample_rate Audio sample rate in Hz
+ */
+void mod_init(ModState *mod, const ModCfg *cfg, double sample_rate);
+
+void mod_note_off(ModState *mod);
+
+/**
+ * Advance every source by one control tick and sum the routes into the targets
+ * @param mod State to advance, the last values move to prev
+ */
+void mod_tick(ModState *mod);
+
+static inline bool mod_routes(const ModState *mod, ModTarget target)
+{
+    return (mod->dst_mask >> target) & 1;
+}
+
+/**
+ * Target value interpolated between the last two ticks
+ * @param mod Modulation state
+ * @param target Target to read
+ * @param pos Frames since the last tick, 0 to MOD_CONTROL_RATE
+ * @return Interpolated target value
+ */
+static inline double mod_value_at(const ModState *mod, ModTarget target, int pos)
+{
+    return mod->prev[target] + (mod->value[target] - mod->prev[target]) * pos * (1.0 / MOD_CONTROL_RATE);
+}
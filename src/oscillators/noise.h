@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdint.h>
+
+#define NOISE_PINK_ROWS 12                  // Voss-McCartney rows, the slowest one changes every 2^12 samples
+#define NOISE_PINK_GAIN 0.27735009811261456 // 1 / sqrt(rows + 1), same RMS as white
+#define NOISE_BROWN_LEAK 0.998              // leaky integrator, corner around 14 Hz at 44.1 kHz, keeps brown from drifting
+#define NOISE_BROWN_GAIN 0.06321392251711644 // sqrt(1 - leak^2), same RMS as white
+#define NOISE_ROW_KEY 0x5bd1e995u           // second stream of a generator, feeds the pink rows
+#define NOISE_LEGACY_KEY 0x68e31da4u        // generate_noise, one stream per thread
+
+typedef enum
+{
+    NOISE_WHITE,
+    NOISE_PINK,
+    NOISE_BROWN,
+} NoiseColor;
+
+// Counter based noise: sample n of a stream is a pure hash of (key, n)
+// No shared state and no lock, streams are reproducible from the key and blocks fill lane by lane
+typedef struct
+{
+    NoiseColor color;
+    uint32_t key;     // stream
+    uint32_t counter; // next sample index
+    int32_t rows[NOISE_PINK_ROWS]; // pink only, integer so the running sum never drifts
+    int32_t pink_sum;
+    double brown; // brown only
+} NoiseGen;
+
+// lowbias32 (Wellons) of the counter, mixed with the key
+static inline uint32_t noise_hash(uint32_t key, uint32_t n)
+{
+    uint32_t x = n * 0x9e3779b9u + key;
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// uniform in [-1, 1)
+static inline float noise_white(uint32_t key, uint32_t n)
+{
+    return (float)(int32_t)noise_hash(key, n) * (1.0f / 2147483648.0f);
+}
+
+// pink row value, 4 bits of headroom so the sum of every row and the white part fits an int32
+static inline int32_t noise_row(uint32_t key, uint32_t n)
+{
+    return (int32_t)noise_hash(key ^ NOISE_ROW_KEY, n) >> 4;
+}
+
+/**
+ * Start a stream
+ * @param gen Generator to set up
+ * @param color Spectrum of the stream
+ * @param key Stream key, equal keys give equal streams
+ */
+static inline void noise_init(NoiseGen *gen, NoiseColor color, uint32_t key)
+{
+    gen->color = color;
+    gen->key = key;
+    gen->counter = 0;
+    gen->brown = 0.0;
+
+    // rows start filled so pink is settled from the first sample
+    gen->pink_sum = 0;
+    for (int r = 0; r < NOISE_PINK_ROWS; r++)
+    {
+        gen->rows[r] = noise_row(key, UINT32_MAX - r);
+        gen->pink_sum += gen->rows[r];
+    }
+}
+
+// Voss-McCartney: sample n renews the row of its lowest set bit, row k changes every 2^(k+1) samples
+static inline float noise_pink_step(NoiseGen *gen, uint32_t n)
+{
+    if (n != 0)
+    {
+        int row = __builtin_ctz(n);
+        if (row < NOISE_PINK_ROWS)
+        {
+            int32_t value = noise_row(gen->key, n);
+            gen->pink_sum += value - gen->rows[row];
+            gen->rows[row] = value;
+        }
+    }
+
+    int32_t sum = gen->pink_sum + ((int32_t)noise_hash(gen->key, n) >> 4);
+    return (float)sum * (float)(NOISE_PINK_GAIN / 134217728.0); // rows are 2^27 full scale
+}
+
+static inline float noise_brown_step(NoiseGen *gen, float white)
+{
+    gen->brown = gen->brown * NOISE_BROWN_LEAK + white * NOISE_BROWN_GAIN;
+    return (float)gen->brown;
+}
+
+/**
+ * Next sample of a stream
+ * @param gen Generator to advance
+ * @return Sample, white is within [-1, 1), pink and brown have the same RMS as white
+ */
+static inline float noise_next(NoiseGen *gen)
+{
+    uint32_t n = gen->counter++;
+
+    switch (gen->color)
+    {
+    case NOISE_PINK:
+        return noise_pink_step(gen, n);
+    case NOISE_BROWN:
+        return noise_brown_step(gen, noise_white(gen->key, n));
+    default:
+        return noise_white(gen->key, n);
+    }
+}
+
+/**
+ * Fill a block, same samples as calling noise_next frames times
+ * @param gen Generator to advance
+ * @param out Receives the samples
+ * @param frames Samples to render
+ */
+static inline void noise_render(NoiseGen *gen, float *out, int frames)
+{
+    uint32_t key = gen->key;
+    uint32_t counter = gen->counter;
+
+    switch (gen->color)
+    {
+    case NOISE_PINK:
+        for (int i = 0; i < frames; i++)
+            out[i] = noise_pink_step(gen, counter + (uint32_t)i);
+        break;
+    case NOISE_BROWN:
+        // white first, every lane stands alone, then the integrator
+        for (int i = 0; i < frames; i++)
+            out[i] = noise_white(key, counter + (uint32_t)i);
+        for (int i = 0; i < frames; i++)
+            out[i] = noise_brown_step(gen, out[i]);
+        break;
+    default:
+        for (int i = 0; i < frames; i++)
+            out[i] = noise_white(key, counter + (uint32_t)i);
+        break;
+    }
+
+    gen->counter = counter + (uint32_t)frames;
+}
@@ -1,16 +1,17 @@
 #include "oscillators.h"
 
 #include <math.h>
-#include <stdlib.h>
 
 #include "../utils/constant.h"
+#include "../utils/fastmath.h"
+#include "noise.h"
 
 double generate_sine(double phase) {
-    return sin(phase);
+    return fastmath_sin(phase);
 }
 
 double generate_square(double phase) {
-    return sin(phase) > 0.0 ? 1.0 : -1.0;
+    return fastmath_sin(phase) > 0.0 ? 1.0 : -1.0;
 }
 
 double generate_sawtooth(double phase) {
@@ -22,8 +23,10 @@ double generate_triangle(double phase) {
     return saw > 0.0 ? 2.0 * saw - 1.0 : -2.0 * saw - 1.0;
 }
 
+// one stream per thread, voices use their own NoiseGen
 double generate_noise(void) {
-    return ((double)rand() / RAND_MAX) * 2.0 - 1.0;
+    static _Thread_local uint32_t counter = 0;
+    return noise_white(NOISE_LEGACY_KEY, counter++);
 }
 
 double generate_waveform(WaveType type, double phase) {
@@ -32,7 +35,9 @@ double generate_waveform(WaveType type, double phase) {
         case WAVE_SQUARE:   return generate_square(phase);
         case WAVE_SAWTOOTH: return generate_sawtooth(phase);
         case WAVE_TRIANGLE: return generate_triangle(phase);
-        case WAVE_NOISE:    return generate_noise();
+        case WAVE_NOISE:
+        case WAVE_PINK_NOISE:
+        case WAVE_BROWN_NOISE: return generate_noise();
         default:            return generate_sine(phase);
     }
 }
@@ -41,12 +46,8 @@ double phase_increment(double frequency, double sample_rate) {
     return 2.0 * M_PI * frequency / sample_rate;
 }
 
+// one floor instead of a loop per cycle, rounding can land on 2 pi for tiny negative phases
 double wrap_phase(double phase) {
-    while (phase >= 2.0 * M_PI) {
-        phase -= 2.0 * M_PI;
-    }
-    while (phase < 0.0) {
-        phase += 2.0 * M_PI;
-    }
-    return phase;
+    double wrapped = phase - 2.0 * M_PI * floor(phase / (2.0 * M_PI));
+    return wrapped < 2.0 * M_PI ? wrapped : 0.0;
 }
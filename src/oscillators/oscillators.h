@@ -7,7 +7,9 @@ typedef enum {
     WAVE_SQUARE,
     WAVE_SAWTOOTH,
     WAVE_TRIANGLE,
-    WAVE_NOISE,
+    WAVE_NOISE,       // white
+    WAVE_PINK_NOISE,  // -3 dB/octave, Voss-McCartney
+    WAVE_BROWN_NOISE, // -6 dB/octave, leaky integrated white
 } WaveType;
 
 
@@ -19,6 +21,7 @@ double generate_triangle(double phase);
 double generate_noise(void);
 double generate_waveform(WaveType type, double phase);
 
-// Phase utilities
+// Phase utilities, radians for the generate_* functions above
+// The render paths use 32bit DDS accumulators instead, see wavetable_phase_increment
 double phase_increment(double frequency, double sample_rate);
 double wrap_phase(double phase);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "oscillators.h"
+
+#define POLYBLEP_PHASE_SCALE (1.0 / 4294967296.0) // DDS phase to cycles
+
+// Analytic square/sawtooth/triangle with polynomial corrections around each discontinuity
+// Cheaper on memory than the wavetables, the residual aliasing is well below the fundamental
+// Phases are the same 32bit DDS accumulators as the wavetables, so a layer can switch between them freely
+
+// 2 sample polynomial step residual, t is the phase in cycles, dt the increment in cycles
+static inline double polyblep(double t, double dt)
+{
+    if (t < dt)
+    {
+        double x = t / dt;
+        return x + x - x * x - 1.0;
+    }
+    if (t > 1.0 - dt)
+    {
+        double x = (t - 1.0) / dt;
+        return x * x + x + x + 1.0;
+    }
+    return 0.0;
+}
+
+// integrated polyblep, residual of a unit slope change per sample
+static inline double polyblamp(double t, double dt)
+{
+    if (t < dt)
+    {
+        double x = 1.0 - t / dt;
+        return x * x * x * (1.0 / 6.0);
+    }
+    if (t > 1.0 - dt)
+    {
+        double x = 1.0 - (1.0 - t) / dt;
+        return x * x * x * (1.0 / 6.0);
+    }
+    return 0.0;
+}
+
+static inline double polyblep_square(uint32_t phase, uint32_t phase_inc)
+{
+    double t = phase * POLYBLEP_PHASE_SCALE;
+    double t_half = (uint32_t)(phase + 0x80000000u) * POLYBLEP_PHASE_SCALE;
+    double dt = phase_inc * POLYBLEP_PHASE_SCALE;
+
+    // rising edge at 0, falling edge at half a cycle
+    double value = phase < 0x80000000u ? 1.0 : -1.0;
+    return value + polyblep(t, dt) - polyblep(t_half, dt);
+}
+
+static inline double polyblep_sawtooth(uint32_t phase, uint32_t phase_inc)
+{
+    // generate_sawtooth ramps through 0 at phase 0 and drops at half a cycle
+    double t = (uint32_t)(phase + 0x80000000u) * POLYBLEP_PHASE_SCALE;
+    double dt = phase_inc * POLYBLEP_PHASE_SCALE;
+
+    return 2.0 * t - 1.0 - polyblep(t, dt);
+}
+
+static inline double polyblep_triangle(uint32_t phase, uint32_t phase_inc)
+{
+    double t = phase * POLYBLEP_PHASE_SCALE;
+    double t_half = (uint32_t)(phase + 0x80000000u) * POLYBLEP_PHASE_SCALE;
+    double dt = phase_inc * POLYBLEP_PHASE_SCALE;
+
+    // corners at 0 (slope -4 -> +4) and half a cycle (+4 -> -4), in units per cycle
+    double value = phase < 0x80000000u ? 4.0 * t - 1.0 : 3.0 - 4.0 * t;
+    return value + 8.0 * dt * (polyblamp(t, dt) - polyblamp(t_half, dt));
+}
+
+/**
+ * One polyblep sample
+ * @param type Square, sawtooth or triangle, anything else returns 0
+ * @param phase DDS phase, 2^32 is one cycle
+ * @param phase_inc Phase increment per sample
+ * @return Sample in [-1, 1] give or take the correction overshoot
+ */
+static inline double polyblep_sample(WaveType type, uint32_t phase, uint32_t phase_inc)
+{
+    switch (type)
+    {
+    case WAVE_SQUARE:
+        return polyblep_square(phase, phase_inc);
+    case WAVE_SAWTOOTH:
+        return polyblep_sawtooth(phase, phase_inc);
+    case WAVE_TRIANGLE:
+        return polyblep_triangle(phase, phase_inc);
+    default:
+        return 0.0;
+    }
+}
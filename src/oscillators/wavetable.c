@@ -0,0 +1,133 @@
+#include "wavetable.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "../utils/constant.h"
+
+#define WAVETABLE_STRIDE (WAVETABLE_SIZE + WAVETABLE_GUARD)
+
+// one sine table is enough for every level, the other waves get a full mip chain
+// all of them share one array so vector code can address any table by an offset from its start
+static float wavetable_storage[1 + 3 * WAVETABLE_LEVELS][WAVETABLE_STRIDE];
+
+// first storage row of each waveform
+#define SINE_TABLE 0
+#define SQUARE_TABLES 1
+#define SAWTOOTH_TABLES (1 + WAVETABLE_LEVELS)
+#define TRIANGLE_TABLES (1 + 2 * WAVETABLE_LEVELS)
+
+static bool wavetable_ready = false;
+
+// copy the wrap around samples, table[-1] and table[SIZE..SIZE+1]
+static void wavetable_fill_guard(float *buf)
+{
+    buf[0] = buf[WAVETABLE_SIZE];
+    buf[WAVETABLE_SIZE + 1] = buf[1];
+    buf[WAVETABLE_SIZE + 2] = buf[2];
+}
+
+// Fourier coefficient of harmonic n, the waveforms match generate_* in oscillators.c
+static double harmonic_gain(WaveType type, int n)
+{
+    switch (type)
+    {
+    case WAVE_SQUARE:
+        return n % 2 ? 4.0 / (M_PI * n) : 0.0;
+    case WAVE_SAWTOOTH:
+        return (n % 2 ? 2.0 : -2.0) / (M_PI * n);
+    case WAVE_TRIANGLE:
+        return n % 2 ? -8.0 / (M_PI * M_PI * n * n) : 0.0;
+    default:
+        return 0.0;
+    }
+}
+
+// additive build, levels share their low harmonics so each level starts from the one above it
+static void wavetable_build(WaveType type, int first)
+{
+    static double sum[WAVETABLE_SIZE];
+    static double sine[WAVETABLE_SIZE];
+    static double cosine[WAVETABLE_SIZE];
+
+    for (int i = 0; i < WAVETABLE_SIZE; i++)
+    {
+        sum[i] = 0.0;
+        sine[i] = sin(2.0 * M_PI * i / WAVETABLE_SIZE);
+        cosine[i] = cos(2.0 * M_PI * i / WAVETABLE_SIZE);
+    }
+
+    // triangle is a cosine series, the others are sine series
+    const double *basis = type == WAVE_TRIANGLE ? cosine : sine;
+    int harmonics = 0;
+
+    for (int level = WAVETABLE_LEVELS - 1; level >= 0; level--)
+    {
+        int level_harmonics = (WAVETABLE_SIZE / 2) >> level;
+
+        for (int n = harmonics + 1; n <= level_harmonics; n++)
+        {
+            double gain = harmonic_gain(type, n);
+            if (gain == 0.0)
+                continue;
+
+            for (int i = 0; i < WAVETABLE_SIZE; i++)
+                sum[i] += gain * basis[(i * n) & (WAVETABLE_SIZE - 1)];
+        }
+        harmonics = level_harmonics;
+
+        for (int i = 0; i < WAVETABLE_SIZE; i++)
+            wavetable_storage[first + level][i + 1] = (float)sum[i];
+        wavetable_fill_guard(wavetable_storage[first + level]);
+    }
+}
+
+void wavetable_init(void)
+{
+    if (wavetable_ready)
+        return;
+
+    for (int i = 0; i < WAVETABLE_SIZE; i++)
+        wavetable_storage[SINE_TABLE][i + 1] = (float)sin(2.0 * M_PI * i / WAVETABLE_SIZE);
+    wavetable_fill_guard(wavetable_storage[SINE_TABLE]);
+
+    wavetable_build(WAVE_SQUARE, SQUARE_TABLES);
+    wavetable_build(WAVE_SAWTOOTH, SAWTOOTH_TABLES);
+    wavetable_build(WAVE_TRIANGLE, TRIANGLE_TABLES);
+
+    wavetable_ready = true;
+}
+
+const float *wavetable_lookup(WaveType type, uint32_t phase_inc)
+{
+    // harmonics below nyquist: 0.5 cycle per sample / increment
+    uint32_t max_harmonics = phase_inc ? (uint32_t)((1ull << 31) / phase_inc) : WAVETABLE_SIZE / 2;
+
+    int level = 0;
+    while (level < WAVETABLE_LEVELS - 1 && (uint32_t)((WAVETABLE_SIZE / 2) >> level) > max_harmonics)
+        level++;
+
+    switch (type)
+    {
+    case WAVE_SQUARE:
+        return wavetable_storage[SQUARE_TABLES + level] + 1;
+    case WAVE_SAWTOOTH:
+        return wavetable_storage[SAWTOOTH_TABLES + level] + 1;
+    case WAVE_TRIANGLE:
+        return wavetable_storage[TRIANGLE_TABLES + level] + 1;
+    default:
+        return wavetable_storage[SINE_TABLE] + 1;
+    }
+}
+
+const float *wavetable_base(void)
+{
+    return &wavetable_storage[0][0];
+}
+
+uint32_t wavetable_phase_increment(double frequency, double sample_rate)
+{
+    double cycles = frequency / sample_rate;
+    cycles -= floor(cycles);
+    return (uint32_t)(cycles * 4294967296.0);
+}
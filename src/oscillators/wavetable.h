@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "oscillators.h"
+
+#define WAVETABLE_BITS 11
+#define WAVETABLE_SIZE (1 << WAVETABLE_BITS) // samples per cycle
+#define WAVETABLE_LEVELS WAVETABLE_BITS      // mip levels, level k holds (WAVETABLE_SIZE / 2) >> k harmonics
+#define WAVETABLE_GUARD 3                    // wrapped samples around each table for interpolation
+#define WAVETABLE_CUBIC 0                    // 1 = 4 point cubic interpolation, 0 = linear
+
+#define WAVETABLE_FRAC_BITS (32 - WAVETABLE_BITS)
+#define WAVETABLE_FRAC_SCALE (1.0f / (float)(1u << WAVETABLE_FRAC_BITS))
+
+// Bandlimited single cycle tables for sine/square/sawtooth/triangle
+// Phases are 32bit DDS accumulators, 2^32 is one cycle and wraps for free
+void wavetable_init(void);
+
+/**
+ * Pick the table for a waveform played at a fixed pitch
+ * @param type Waveform, noise and none fall back to sine
+ * @param phase_inc Phase increment per sample, picks the richest mip level that does not alias
+ * @return Table pointer valid for indices [-1, WAVETABLE_SIZE + 1]
+ */
+const float *wavetable_lookup(WaveType type, uint32_t phase_inc);
+
+/**
+ * Start of the storage every table lives in
+ * @return Base pointer, table - wavetable_base() is a valid offset for every table from wavetable_lookup
+ */
+const float *wavetable_base(void);
+
+/**
+ * Convert a frequency to a DDS phase increment
+ * @param frequency Frequency in Hz
+ * @param sample_rate Sample rate in Hz
+ * @return Phase increment per sample
+ */
+uint32_t wavetable_phase_increment(double frequency, double sample_rate);
+
+static inline float wavetable_read(const float *table, uint32_t phase)
+{
+    uint32_t index = phase >> WAVETABLE_FRAC_BITS;
+    float frac = (float)(phase & ((1u << WAVETABLE_FRAC_BITS) - 1)) * WAVETABLE_FRAC_SCALE;
+
+#if WAVETABLE_CUBIC
+    // Catmull-Rom through the 4 neighbouring samples
+    float y0 = table[(int)index - 1];
+    float y1 = table[index];
+    float y2 = table[index + 1];
+    float y3 = table[index + 2];
+
+    float c1 = 0.5f * (y2 - y0);
+    float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+    float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+    return ((c3 * frac + c2) * frac + c1) * frac + y1;
+#else
+    float y1 = table[index];
+    float y2 = table[index + 1];
+    return y1 + frac * (y2 - y1);
+#endif
+}
@@ -4,6 +4,9 @@
 #include <math.h>
 #include <stdbool.h>
 
+#include "../utils/fastmath.h"
+#include "../utils/sample.h"
+
 #define PEDAL_MAX_PARAMS 8
 
 typedef struct {
@@ -28,7 +31,7 @@ static double soft_clip(double input, double drive) {
     double driven = input * (1.0 + drive * 4.0);  // Amplify based on drive
     
     // Soft clipping using hyperbolic tangent
-    return tanh(driven) * 0.7;  // Scale down to prevent excessive volume
+    return fastmath_tanh(driven) * 0.7;  // Scale down to prevent excessive volume
 }
 
 // Asymmetric clipping - adds even harmonics
@@ -88,7 +91,7 @@ void distortion_destroy(void *instance) {
 }
 
 // Process single sample through distortion
-double distortion_process(void *instance, double sample) {
+qsample distortion_process(void *instance, qsample sample) {
     if (!instance) return sample;
     
     distortion_instance_t *dist = (distortion_instance_t*)instance;
@@ -113,7 +116,7 @@ double distortion_process(void *instance, double sample) {
     if (output > 1.0) output = 1.0;
     if (output < -1.0) output = -1.0;
     
-    return output;
+    return (qsample)output;
 }
 
 // Set distortion parameters
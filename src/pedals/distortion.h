@@ -3,8 +3,9 @@
 #include <stdbool.h>
 
 #include "pedal.h"
+#include "../utils/sample.h"
 
 bool distortion_create(void **instance_ptr, double sample_rate);
 void distortion_destroy(void *instance);
-double distortion_process(void *instance, double sample);
+qsample distortion_process(void *instance, qsample sample);
 void distortion_set_params(void *instance, double params[PEDAL_MAX_PARAMS]);
\ No newline at end of file
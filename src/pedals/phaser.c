@@ -5,6 +5,9 @@
 #include <stdbool.h>
 
 #include "phaser.h"
+#include "../modulation/modulation.h"
+#include "../oscillators/wavetable.h"
+#include "../utils/fastmath.h"
 
 #define NUM_STAGES 4  // Number of allpass filter stages
 
@@ -12,6 +15,8 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+#define LFO_PHASE_TO_RADIANS (2.0 * M_PI / 4294967296.0)
+
 // Allpass filter for phase shifting
 typedef struct {
     double delay;
@@ -25,8 +30,12 @@ typedef struct {
     // Allpass filter stages
     allpass_stage_t stages[NUM_STAGES];
     
-    // LFO for sweeping
-    double lfo_phase;
+    // LFO for sweeping, DDS phase wraps for free, 2^32 is one cycle
+    // evaluated once per MOD_CONTROL_RATE samples, the coefficients ramp in between
+    uint32_t lfo_phase;
+    uint32_t lfo_inc;          // per sample
+    int tick_left;             // samples until the next LFO evaluation
+    double coeff_step[NUM_STAGES];
     
     // Effect parameters  
     double rate;           // LFO rate (0.1-10 Hz)
@@ -48,7 +57,42 @@ static double process_allpass(allpass_stage_t *stage, double input) {
 // Calculate allpass filter coefficients based on frequency
 static double freq_to_allpass_coeff(double frequency, double sample_rate) {
     double omega = 2.0 * M_PI * frequency / sample_rate;
-    return (1.0 - tan(omega / 2.0)) / (1.0 + tan(omega / 2.0));
+    double t = fastmath_tan(omega / 2.0);
+    return (1.0 - t) / (1.0 + t);
+}
+
+// Allpass coefficients of every stage at the current LFO phase
+static void phaser_sweep(const phaser_instance_t *phaser, double coeffs[NUM_STAGES]) {
+    // Generate LFO (sine wave for smooth sweeping)
+    // signed phase, [-pi, pi) keeps the argument small
+    double lfo_value = fastmath_sin((int32_t)phaser->lfo_phase * LFO_PHASE_TO_RADIANS);
+    
+    // Calculate sweep frequency based on LFO and depth
+    double freq_variation = phaser->depth * phaser->center_freq * 0.8;  // 80% of center freq max variation
+    double sweep_freq = phaser->center_freq + lfo_value * freq_variation;
+    
+    // Ensure frequency stays in reasonable range
+    if (sweep_freq < 50.0) sweep_freq = 50.0;
+    if (sweep_freq > 4000.0) sweep_freq = 4000.0;
+    
+    // Use different frequencies for each stage to create richer effect
+    for (int i = 0; i < NUM_STAGES; i++) {
+        double stage_freq = sweep_freq * (1.0 + i * 0.3);  // Spread out frequencies
+        coeffs[i] = freq_to_allpass_coeff(stage_freq, phaser->sample_rate);
+    }
+}
+
+// Control tick: move the LFO one tick ahead and ramp the coefficients towards it
+static void phaser_control_tick(phaser_instance_t *phaser) {
+    double coeffs[NUM_STAGES];
+    
+    phaser->lfo_phase += phaser->lfo_inc * MOD_CONTROL_RATE;
+    phaser_sweep(phaser, coeffs);
+    
+    for (int i = 0; i < NUM_STAGES; i++) {
+        phaser->coeff_step[i] = (coeffs[i] - phaser->stages[i].feedback) / MOD_CONTROL_RATE;
+    }
+    phaser->tick_left = MOD_CONTROL_RATE;
 }
 
 // Create phaser instance
@@ -74,9 +118,18 @@ bool phaser_create(void **instance_ptr, double sample_rate) {
     phaser->wet_dry_mix = 0.5;    // 50% wet
     phaser->center_freq = 800.0;  // 800 Hz center frequency
     
-    phaser->lfo_phase = 0.0;
+    phaser->lfo_phase = 0;
+    phaser->lfo_inc = wavetable_phase_increment(phaser->rate, sample_rate);
     phaser->initialized = true;
     
+    // start on the LFO, the first tick ramps from here
+    double coeffs[NUM_STAGES];
+    phaser_sweep(phaser, coeffs);
+    for (int i = 0; i < NUM_STAGES; i++) {
+        phaser->stages[i].feedback = coeffs[i];
+    }
+    phaser->tick_left = 0;
+    
     *instance_ptr = phaser;
     return true;
 }
@@ -88,29 +141,20 @@ void phaser_destroy(void *instance) {
 }
 
 // Process single sample through phaser
-double phaser_process(void *instance, double sample) {
+qsample phaser_process(void *instance, qsample sample) {
     if (!instance) return sample;
     
     phaser_instance_t *phaser = (phaser_instance_t*)instance;
     if (!phaser->initialized) return sample;
     
-    // Generate LFO (sine wave for smooth sweeping)
-    double lfo_value = sin(phaser->lfo_phase);
-    
-    // Calculate sweep frequency based on LFO and depth
-    double freq_variation = phaser->depth * phaser->center_freq * 0.8;  // 80% of center freq max variation
-    double sweep_freq = phaser->center_freq + lfo_value * freq_variation;
-    
-    // Ensure frequency stays in reasonable range
-    if (sweep_freq < 50.0) sweep_freq = 50.0;
-    if (sweep_freq > 4000.0) sweep_freq = 4000.0;
-    
-    // Update allpass filter coefficients for each stage
-    // Use different frequencies for each stage to create richer effect
+    // Update allpass filter coefficients for each stage, one sin and four tan per control tick
+    if (phaser->tick_left == 0) {
+        phaser_control_tick(phaser);
+    }
     for (int i = 0; i < NUM_STAGES; i++) {
-        double stage_freq = sweep_freq * (1.0 + i * 0.3);  // Spread out frequencies
-        phaser->stages[i].feedback = freq_to_allpass_coeff(stage_freq, phaser->sample_rate);
+        phaser->stages[i].feedback += phaser->coeff_step[i];
     }
+    phaser->tick_left--;
     
     // Process through allpass filter chain
     double processed = sample;
@@ -127,14 +171,7 @@ double phaser_process(void *instance, double sample) {
     double wet_signal = processed * phaser->wet_dry_mix;
     double dry_signal = sample * (1.0 - phaser->wet_dry_mix);
     
-    // Update LFO phase
-    double lfo_increment = 2.0 * M_PI * phaser->rate / phaser->sample_rate;
-    phaser->lfo_phase += lfo_increment;
-    if (phaser->lfo_phase >= 2.0 * M_PI) {
-        phaser->lfo_phase -= 2.0 * M_PI;
-    }
-    
-    return wet_signal + dry_signal;
+    return (qsample)(wet_signal + dry_signal);
 }
 
 // Set phaser parameters
@@ -146,6 +183,7 @@ void phaser_set_params(void *instance, double params[PEDAL_MAX_PARAMS]) {
     
     // Update parameters with bounds checking
     phaser->rate = fmax(0.1, fmin(10.0, params[0]));           // 0.1-10 Hz rate
+    phaser->lfo_inc = wavetable_phase_increment(phaser->rate, phaser->sample_rate);
     phaser->depth = fmax(0.0, fmin(1.0, params[1]));           // 0-100% depth
     phaser->feedback = fmax(0.0, fmin(0.9, params[2]));        // 0-90% feedback
     phaser->wet_dry_mix = fmax(0.0, fmin(1.0, params[3]));     // 0-100% wet
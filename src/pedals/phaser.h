@@ -1,11 +1,12 @@
 #pragma once
 
 #include "pedal.h"
+#include "../utils/sample.h"
 
 #include <stdbool.h>
 
 
 bool phaser_create(void **instance_ptr, double sample_rate);
 void phaser_destroy(void *instance);
-double phaser_process(void *instance, double sample);
+qsample phaser_process(void *instance, qsample sample);
 void phaser_set_params(void *instance, double params[PEDAL_MAX_PARAMS]);
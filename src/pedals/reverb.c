@@ -5,6 +5,7 @@
 #include <stdbool.h>
 
 #include "reverb.h"
+#include "../utils/fastmath.h"
 
 #define MAX_COMB_FILTERS 4
 #define MAX_ALLPASS_FILTERS 2
@@ -249,8 +250,8 @@ void reverb_destroy(void *instance)
     free(reverb);
 }
 
-// Process a single sample through the reverb
-double reverb_process(void *instance, double sample)
+// Process a single sample through the reverb, the comb and allpass lines keep double for their feedback
+qsample reverb_process(void *instance, qsample sample)
 {
     // if (sample == 0.0) return 0.0;
     if (!instance)
@@ -282,7 +283,7 @@ double reverb_process(void *instance, double sample)
     double wet_signal = output * reverb->wet_dry_mix;
     double dry_signal = sample * (1.0 - reverb->wet_dry_mix);
 
-    return reverb->output_level * (wet_signal + dry_signal);
+    return (qsample)(reverb->output_level * (wet_signal + dry_signal));
 }
 
 // Set reverb parameters
@@ -308,7 +309,7 @@ void reverb_set_params(void *instance, double params[PEDAL_MAX_PARAMS])
     {
         // Calculate feedback based on decay time and delay length
         double delay_time = (double)reverb->comb_filters[i].buffer_size / reverb->sample_rate;
-        reverb->comb_filters[i].feedback = pow(0.001, delay_time / reverb->decay_time) * reverb->room_size;
+        reverb->comb_filters[i].feedback = fastmath_pow(0.001, delay_time / reverb->decay_time) * reverb->room_size;
         reverb->comb_filters[i].damping = reverb->damping;
     }
 
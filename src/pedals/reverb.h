@@ -1,11 +1,12 @@
 #pragma once
 
 #include "pedal.h"
+#include "../utils/sample.h"
 
 #include <stdbool.h>
 
 
 bool reverb_create(void **instance_ptr, double sample_rate);
 void reverb_destroy(void *instance);
-double reverb_process(void *instance, double sample);
+qsample reverb_process(void *instance, qsample sample);
 void reverb_set_params(void *instance, double params[PEDAL_MAX_PARAMS]);
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Polynomial approximations of the libm calls on the DSP paths
+// Branch free and header only so loops over them vectorize, errors are measured by tests/fastmath_test.c
+// Accurate to about 1e-7, below the resolution of a float sample, the orders go no higher than that
+// No errno, no NaN/inf handling: inputs outside the documented ranges give garbage, not traps
+
+#define FASTMATH_ROUND_MAGIC 6755399441055744.0 // 1.5 * 2^52, x + magic rounds x to an integer in the low mantissa bits
+
+#define FASTMATH_2_OVER_PI 0.63661977236758134308
+#define FASTMATH_PIO2_HI 1.57079632673412561417e+00 // pi/2 split in two, the high part has 33 significant bits
+#define FASTMATH_PIO2_LO 6.07710050650619224932e-11
+#define FASTMATH_LOG2E 1.44269504088896340736
+#define FASTMATH_LN2 0.69314718055994530942
+
+static inline uint64_t fastmath_bits(double x)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static inline double fastmath_from_bits(uint64_t bits)
+{
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// x = quadrant * pi/2 + r with |r| <= pi/4, sine and cosine of r by Taylor polynomials (degree 9 and 8)
+static inline void fastmath_sincos_reduced(double x, double *sin_r, double *cos_r, uint64_t *quadrant)
+{
+    double shifted = x * FASTMATH_2_OVER_PI + FASTMATH_ROUND_MAGIC;
+    double k = shifted - FASTMATH_ROUND_MAGIC;
+    double r = (x - k * FASTMATH_PIO2_HI) - k * FASTMATH_PIO2_LO;
+    double r2 = r * r;
+
+    *sin_r = r + r * r2 * (-1.0 / 6.0 + r2 * (1.0 / 120.0 + r2 * (-1.0 / 5040.0 + r2 * (1.0 / 362880.0))));
+    *cos_r = 1.0 - 0.5 * r2 + r2 * r2 * (1.0 / 24.0 + r2 * (-1.0 / 720.0 + r2 * (1.0 / 40320.0)));
+    *quadrant = fastmath_bits(shifted); // low bits hold k, two's complement for negative k
+}
+
+/**
+ * Sine
+ * @param x Angle in radians, |x| < 1e5
+ * @return sin(x), absolute error below 5e-8
+ */
+static inline double fastmath_sin(double x)
+{
+    double s, c;
+    uint64_t quadrant;
+    fastmath_sincos_reduced(x, &s, &c, &quadrant);
+
+    double y = quadrant & 1 ? c : s;
+    return quadrant & 2 ? -y : y;
+}
+
+/**
+ * Cosine
+ * @param x Angle in radians, |x| < 1e5
+ * @return cos(x), absolute error below 5e-8
+ */
+static inline double fastmath_cos(double x)
+{
+    double s, c;
+    uint64_t quadrant;
+    fastmath_sincos_reduced(x, &s, &c, &quadrant);
+
+    double y = quadrant & 1 ? s : c;
+    return (quadrant + 1) & 2 ? -y : y;
+}
+
+/**
+ * Tangent
+ * @param x Angle in radians, |x| < 1e5 and not within 1e-6 of a pole
+ * @return tan(x), relative error below 5e-8 for |x| <= 1.5
+ */
+static inline double fastmath_tan(double x)
+{
+    double s, c;
+    uint64_t quadrant;
+    fastmath_sincos_reduced(x, &s, &c, &quadrant);
+
+    return quadrant & 1 ? -c / s : s / c;
+}
+
+/**
+ * Power of two
+ * @param x Exponent, clamped to [-1022, 1023]
+ * @return 2^x, relative error below 2e-7
+ */
+static inline double fastmath_exp2(double x)
+{
+    x = x < -1022.0 ? -1022.0 : x;
+    x = x > 1023.0 ? 1023.0 : x;
+
+    double shifted = x + FASTMATH_ROUND_MAGIC;
+    double k = shifted - FASTMATH_ROUND_MAGIC;
+    double f = (x - k) * FASTMATH_LN2; // |f| <= ln2 / 2
+
+    // e^f, Taylor to degree 6
+    double p = 1.0 + f * (1.0 + f * (1.0 / 2.0 + f * (1.0 / 6.0 + f * (1.0 / 24.0 + f * (1.0 / 120.0 +
+               f * (1.0 / 720.0))))));
+
+    // 2^k straight into the exponent bits, the mantissa of shifted holds 2^51 + k
+    uint64_t biased = (fastmath_bits(shifted) & ((1ull << 52) - 1)) - (1ull << 51) + 1023;
+    return p * fastmath_from_bits(biased << 52);
+}
+
+/**
+ * Base 2 logarithm
+ * @param x Positive normal number
+ * @return log2(x), absolute error below 5e-8
+ */
+static inline double fastmath_log2(double x)
+{
+    uint64_t bits = fastmath_bits(x);
+    int32_t exponent = (int32_t)((bits >> 52) & 0x7ff) - 1023;
+    double m = fastmath_from_bits((bits & ((1ull << 52) - 1)) | (1023ull << 52)); // [1, 2)
+
+    // center the mantissa on 1, [sqrt(1/2), sqrt(2))
+    int32_t high = m > 1.41421356237309504880;
+    m = high ? m * 0.5 : m;
+    exponent += high;
+
+    // log(m) = 2 atanh(t), t = (m - 1) / (m + 1), |t| <= 0.172
+    double t = (m - 1.0) / (m + 1.0);
+    double t2 = t * t;
+    double series = 1.0 + t2 * (1.0 / 3.0 + t2 * (1.0 / 5.0 + t2 * (1.0 / 7.0)));
+    return (double)exponent + 2.0 * FASTMATH_LOG2E * t * series;
+}
+
+/**
+ * Power with a positive base
+ * @param base Positive normal number
+ * @param exponent Exponent, base^exponent has to stay within the double range
+ * @return base^exponent, relative error below 2e-6 for results within 2^+-16
+ */
+static inline double fastmath_pow(double base, double exponent)
+{
+    return fastmath_exp2(exponent * fastmath_log2(base));
+}
+
+/**
+ * Hyperbolic tangent
+ * @param x Any finite value
+ * @return tanh(x), absolute error below 1e-7
+ */
+static inline double fastmath_tanh(double x)
+{
+    // saturated long before the clamp, keeps 2^(2x log2e) finite
+    x = x < -20.0 ? -20.0 : x;
+    x = x > 20.0 ? 20.0 : x;
+
+    return 1.0 - 2.0 / (fastmath_exp2(2.0 * FASTMATH_LOG2E * x) + 1.0);
+}
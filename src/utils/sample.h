@@ -0,0 +1,14 @@
+#pragma once
+
+// Precision of the audio path: voice mix buffers, filters, envelopes as applied, mix bus, pedal I/O and streams
+// Build with -DQSYNTH_FLOAT32=1 for single precision, buffers shrink to half and every vector holds twice the lanes
+// Phase accumulators, envelope state, filter design and the reverb feedback lines stay double either way
+#ifndef QSYNTH_FLOAT32
+#define QSYNTH_FLOAT32 0
+#endif
+
+#if QSYNTH_FLOAT32
+typedef float qsample;
+#else
+typedef double qsample;
+#endif
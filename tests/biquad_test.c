@@ -0,0 +1,165 @@
+// ===============================================
+// biquad_test.c - filter cascades (FilterCfg.stages) against single sections
+// ===============================================
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../src/utils/constant.h"
+#include "../src/filters/biquad.h"
+#include "../src/core/voice.h"
+#include "../src/oscillators/wavetable.h"
+#include "../src/assets/instruments_core.h"
+
+#define SAMPLE_RATE 44100.0
+#define TEST_FRAMES 8192
+#define SETTLE_FRAMES 4096 // skipped before measuring, the transient of a 200 Hz lowpass is long gone
+#define DRONE_CUTOFF 200.0
+
+static qsample input[TEST_FRAMES];
+static qsample cascade[TEST_FRAMES];
+static qsample chained[TEST_FRAMES];
+
+static void fill_sine(qsample *buf, double freq)
+{
+    for (int i = 0; i < TEST_FRAMES; i++)
+        buf[i] = (qsample)sin(2.0 * M_PI * freq * i / SAMPLE_RATE);
+}
+
+// rms of the settled part of a block
+static double settled_rms(const qsample *buf)
+{
+    double sum = 0.0;
+    for (int i = SETTLE_FRAMES; i < TEST_FRAMES; i++)
+        sum += (double)buf[i] * buf[i];
+    return sqrt(sum / (TEST_FRAMES - SETTLE_FRAMES));
+}
+
+// steady state gain in dB of a lowpass at freq
+static double lowpass_gain_db(int stages, double freq)
+{
+    FilterCfg cfg = {.filter_type = FILTER_LOWPASS, .cutoff = DRONE_CUTOFF, .resonance = 0.5, .stages = stages};
+    BiquadCoeffs coeffs;
+    BiquadFilter filter;
+    biquad_design(&coeffs, &cfg, SAMPLE_RATE);
+    biquad_init(&filter, &cfg, &coeffs);
+
+    fill_sine(input, freq);
+    double in_rms = settled_rms(input);
+    biquad_process_block(&filter, input, TEST_FRAMES);
+    return 20.0 * log10(settled_rms(input) / in_rms);
+}
+
+// a cascade of n stages is exactly n single sections in series
+static bool check_cascade_matches_chain(int stages)
+{
+    FilterCfg cfg = {.filter_type = FILTER_LOWPASS, .cutoff = DRONE_CUTOFF, .resonance = 0.5, .stages = stages};
+    FilterCfg single = cfg;
+    single.stages = 1;
+
+    BiquadCoeffs coeffs;
+    BiquadFilter filter;
+    biquad_design(&coeffs, &cfg, SAMPLE_RATE);
+    biquad_init(&filter, &cfg, &coeffs);
+    fill_sine(cascade, 110.0);
+    biquad_process_block(&filter, cascade, TEST_FRAMES);
+
+    fill_sine(chained, 110.0);
+    for (int st = 0; st < stages; st++)
+    {
+        biquad_init(&filter, &single, &coeffs);
+        biquad_process_block(&filter, chained, TEST_FRAMES);
+    }
+
+    int mismatch = 0;
+    for (int i = 0; i < TEST_FRAMES; i++)
+        mismatch += cascade[i] != chained[i];
+
+    printf("%d stages vs %d single sections: %d of %d frames differ %s\n", stages, stages, mismatch, TEST_FRAMES,
+           mismatch ? "FAIL" : "ok");
+    return mismatch == 0;
+}
+
+// identical sections multiply their responses, the slope of n stages is n times the slope of one
+// measured two octaves above the cutoff, float32 runs out of headroom further up
+static bool check_slope(int stages)
+{
+    double single_drop = lowpass_gain_db(1, DRONE_CUTOFF * 2.0) - lowpass_gain_db(1, DRONE_CUTOFF * 4.0);
+    double octave_drop = lowpass_gain_db(stages, DRONE_CUTOFF * 2.0) - lowpass_gain_db(stages, DRONE_CUTOFF * 4.0);
+    double expected = single_drop * stages;
+    bool pass = fabs(octave_drop - expected) < 0.05 * stages;
+
+    printf("%d stages: %.2f dB/oct above the cutoff (expected %.2f) %s\n", stages, octave_drop, expected,
+           pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// a sweep lands on the design of each tick, and a sweep held at one cutoff is the static filter
+static bool check_sweep(void)
+{
+    FilterCfg cfg = {.filter_type = FILTER_LOWPASS, .cutoff = DRONE_CUTOFF, .resonance = 0.5, .stages = 2};
+    BiquadCoeffs coeffs;
+    BiquadFilter filter, swept;
+    BiquadSweep sweep;
+    biquad_design(&coeffs, &cfg, SAMPLE_RATE);
+    biquad_init(&filter, &cfg, &coeffs);
+    biquad_init(&swept, &cfg, NULL);
+    biquad_sweep_start(&sweep, &swept, DRONE_CUTOFF, SAMPLE_RATE);
+
+    fill_sine(cascade, 110.0);
+    fill_sine(chained, 110.0);
+    biquad_process_block(&filter, cascade, TEST_FRAMES);
+    biquad_sweep_to(&sweep, &swept, DRONE_CUTOFF, TEST_FRAMES, SAMPLE_RATE);
+    biquad_process_block_sweep(&swept, &sweep, chained, TEST_FRAMES);
+
+    int mismatch = 0;
+    for (int i = 0; i < TEST_FRAMES; i++)
+        mismatch += cascade[i] != chained[i];
+
+    // up an octave per tick of 32 frames, the ramp ends on the target design
+    double error = 0.0;
+    for (double cutoff = DRONE_CUTOFF * 2.0; cutoff < SAMPLE_RATE * 0.25; cutoff *= 2.0)
+    {
+        biquad_sweep_to(&sweep, &swept, cutoff, 32, SAMPLE_RATE);
+        biquad_process_block_sweep(&swept, &sweep, chained, 32);
+
+        cfg.cutoff = cutoff;
+        biquad_design(&coeffs, &cfg, SAMPLE_RATE);
+        error = fmax(error, fabs((double)(sweep.coeffs.b1 - coeffs.b1)));
+        error = fmax(error, fabs((double)(sweep.coeffs.b2 - coeffs.b2)));
+    }
+    bool pass = mismatch == 0 && error < 1e-4;
+
+    printf("sweep: %d of %d frames differ from the static filter, %.2g off the tick design %s\n", mismatch, TEST_FRAMES,
+           error, pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// a two stage Deep Drone still renders through a fused kernel (table3_biquad2 of voice_kernels.h)
+static bool check_drone_fused(int stages)
+{
+    Tone tone = instrument_get_signature(INST_DEEP_DRONE)->tone;
+    tone.filter_opt.stages = stages;
+
+    bool pass = voice_tone_is_fused(&tone, SAMPLE_RATE);
+    printf("Deep Drone with %d stages: %s kernel %s\n", stages, pass ? "fused" : "generic", pass ? "ok" : "FAIL");
+    return pass;
+}
+
+int main(void)
+{
+    wavetable_init();
+
+    int failed = 0;
+    for (int stages = 1; stages <= BIQUAD_MAX_STAGES; stages++)
+    {
+        failed += !check_cascade_matches_chain(stages);
+        failed += !check_slope(stages);
+    }
+    failed += !check_sweep();
+    failed += !check_drone_fused(1);
+    failed += !check_drone_fused(2);
+
+    printf("%s\n", failed ? "biquad: FAILED" : "biquad: all cascades ok");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+// ===============================================
+// fastmath_test.c - sweep the fast math approximations against libm
+// ===============================================
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "../src/utils/constant.h"
+#include "../src/utils/fastmath.h"
+
+#define SWEEP_POINTS 2000000
+#define BENCH_BLOCK 1024
+#define BENCH_ROUNDS 4000
+
+typedef enum
+{
+    ERROR_ABSOLUTE,
+    ERROR_RELATIVE
+} ErrorKind;
+
+typedef struct
+{
+    const char *name;
+    double (*fast)(double);
+    double (*reference)(double);
+    double lo, hi;
+    bool log_sweep; // points spread evenly over log2 of the range, lo > 0
+    ErrorKind kind;
+    double bound; // documented max error in fastmath.h
+} Sweep;
+
+static double exp2_ref(double x) { return exp2(x); }
+static double log2_ref(double x) { return log2(x); }
+static double pow_base(double x) { return fastmath_pow(0.001, x); }
+static double pow_base_ref(double x) { return pow(0.001, x); }
+
+// max error of fast against reference over the range, returns false if it is above the bound
+static bool run_sweep(const Sweep *sweep)
+{
+    double max_error = 0.0;
+    double worst_x = sweep->lo;
+
+    for (int i = 0; i <= SWEEP_POINTS; i++)
+    {
+        double t = (double)i / SWEEP_POINTS;
+        double x = sweep->log_sweep ? exp2(log2(sweep->lo) + t * (log2(sweep->hi) - log2(sweep->lo)))
+                                    : sweep->lo + t * (sweep->hi - sweep->lo);
+
+        double expected = sweep->reference(x);
+        double error = fabs(sweep->fast(x) - expected);
+        if (sweep->kind == ERROR_RELATIVE && expected != 0.0)
+            error /= fabs(expected);
+
+        if (error > max_error)
+        {
+            max_error = error;
+            worst_x = x;
+        }
+    }
+
+    bool pass = max_error <= sweep->bound;
+    printf("%-5s [%g, %g] %s error %.3e at %.6g (bound %.0e) %s\n", sweep->name, sweep->lo, sweep->hi,
+           sweep->kind == ERROR_ABSOLUTE ? "abs" : "rel", max_error, worst_x, sweep->bound, pass ? "ok" : "FAIL");
+    return pass;
+}
+
+// cost per value over a block, the calls are inlined so the fast versions can vectorize
+static double bench_in[BENCH_BLOCK];
+static double bench_out[BENCH_BLOCK];
+
+#define BENCH(name, fast, reference, lo, hi)                                                          \
+    {                                                                                                 \
+        for (int i = 0; i < BENCH_BLOCK; i++)                                                         \
+            bench_in[i] = (lo) + ((hi) - (lo)) * i / BENCH_BLOCK;                                     \
+        clock_t start = clock();                                                                      \
+        for (int r = 0; r < BENCH_ROUNDS; r++)                                                        \
+            for (int i = 0; i < BENCH_BLOCK; i++)                                                     \
+                bench_out[i] += fast(bench_in[i]);                                                    \
+        clock_t fast_ticks = clock() - start;                                                         \
+        start = clock();                                                                              \
+        for (int r = 0; r < BENCH_ROUNDS; r++)                                                        \
+            for (int i = 0; i < BENCH_BLOCK; i++)                                                     \
+                bench_out[i] += reference(bench_in[i]);                                               \
+        clock_t ref_ticks = clock() - start;                                                          \
+        double per_value = 1e9 / CLOCKS_PER_SEC / ((double)BENCH_ROUNDS * BENCH_BLOCK);               \
+        printf("%-5s %.2f ns, libm %.2f ns\n", name, fast_ticks * per_value, ref_ticks * per_value); \
+    }
+
+int main(void)
+{
+    const Sweep sweeps[] = {
+        {"sin", fastmath_sin, sin, -1e5, 1e5, false, ERROR_ABSOLUTE, 5e-8},
+        {"sin", fastmath_sin, sin, -2.0 * M_PI, 2.0 * M_PI, false, ERROR_ABSOLUTE, 5e-8},
+        {"cos", fastmath_cos, cos, -1e5, 1e5, false, ERROR_ABSOLUTE, 5e-8},
+        {"cos", fastmath_cos, cos, -2.0 * M_PI, 2.0 * M_PI, false, ERROR_ABSOLUTE, 5e-8},
+        {"tan", fastmath_tan, tan, -1.5, 1.5, false, ERROR_RELATIVE, 5e-8},
+        {"tanh", fastmath_tanh, tanh, -40.0, 40.0, false, ERROR_ABSOLUTE, 1e-7},
+        {"tanh", fastmath_tanh, tanh, -3.0, 3.0, false, ERROR_ABSOLUTE, 1e-7},
+        {"exp2", fastmath_exp2, exp2_ref, -1022.0, 1023.0, false, ERROR_RELATIVE, 2e-7},
+        {"exp2", fastmath_exp2, exp2_ref, -1.0, 1.0, false, ERROR_RELATIVE, 2e-7},
+        {"log2", fastmath_log2, log2_ref, 0x1p-1022, 0x1p1023, true, ERROR_ABSOLUTE, 5e-8},
+        {"log2", fastmath_log2, log2_ref, 0.5, 2.0, false, ERROR_ABSOLUTE, 5e-8},
+        {"pow", pow_base, pow_base_ref, 0.0, 10.0, false, ERROR_RELATIVE, 2e-6},
+    };
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(sweeps) / sizeof(sweeps[0]); i++)
+    {
+        if (!run_sweep(&sweeps[i]))
+            failed++;
+    }
+
+    BENCH("sin", fastmath_sin, sin, -M_PI, M_PI);
+    BENCH("tan", fastmath_tan, tan, -1.5, 1.5);
+    BENCH("tanh", fastmath_tanh, tanh, -3.0, 3.0);
+    BENCH("exp2", fastmath_exp2, exp2, -10.0, 10.0);
+    BENCH("log2", fastmath_log2, log2, 0.01, 100.0);
+
+    printf("%s\n", failed ? "fastmath: FAILED" : "fastmath: all within bounds");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// ===============================================
+// offline_render.c - headless bounce + DSP benchmark
+// ===============================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "qsynth.h"
+#include "instruments.h"
+
+#define SAMPLE_RATE 44100
+#define STEP_FRAMES (SAMPLE_RATE / 4) // 16th notes at 60bpm
+#define TAIL_FRAMES (SAMPLE_RATE * 2)
+#define RENDER_CHUNK 1000
+
+static void write_u32(FILE *f, uint32_t v)
+{
+    fputc(v & 0xff, f);
+    fputc((v >> 8) & 0xff, f);
+    fputc((v >> 16) & 0xff, f);
+    fputc((v >> 24) & 0xff, f);
+}
+
+static void write_u16(FILE *f, uint16_t v)
+{
+    fputc(v & 0xff, f);
+    fputc((v >> 8) & 0xff, f);
+}
+
+// 16bit stereo wav
+static bool write_wav(const char *path, const float *samples, uint32_t frames)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    uint32_t data_size = frames * 2 * sizeof(int16_t);
+
+    fwrite("RIFF", 1, 4, f);
+    write_u32(f, 36 + data_size);
+    fwrite("WAVEfmt ", 1, 8, f);
+    write_u32(f, 16);
+    write_u16(f, 1); // PCM
+    write_u16(f, 2);
+    write_u32(f, SAMPLE_RATE);
+    write_u32(f, SAMPLE_RATE * 2 * sizeof(int16_t));
+    write_u16(f, 2 * sizeof(int16_t));
+    write_u16(f, 16);
+    fwrite("data", 1, 4, f);
+    write_u32(f, data_size);
+
+    for (uint32_t i = 0; i < frames * 2; i++)
+        write_u16(f, (uint16_t)(int16_t)(samples[i] * 32767));
+
+    fclose(f);
+    return true;
+}
+
+int main()
+{
+    Synthesizer *synth;
+    if (!synth_init_offline(&synth, SAMPLE_RATE, 2))
+    {
+        printf("Failed to initialize synthesizer: %s\n",
+               synth_get_error_string(synth_get_last_error()));
+        return 1;
+    }
+
+    synth_pedalchain_append(synth, PEDAL_REVERB);
+
+    int melody[] = {60, 64, 67, 72, 67, 64, 60, 55, 57, 60, 64, 69, 64, 60, 57, 52};
+    int melody_len = sizeof(melody) / sizeof(melody[0]);
+    int loops = 4;
+
+    uint32_t total_frames = loops * melody_len * STEP_FRAMES + TAIL_FRAMES;
+    float *out = malloc(total_frames * 2 * sizeof(float));
+    if (!out)
+    {
+        printf("out of memory\n");
+        synth_cleanup(synth);
+        return 1;
+    }
+
+    // the whole sequence is submitted up front, every note lands on its exact frame
+    for (int l = 0; l < loops; l++)
+    {
+        for (int i = 0; i < melody_len; i++)
+        {
+            uint64_t frame_time = (uint64_t)(l * melody_len + i) * STEP_FRAMES;
+
+            NoteCfg cfg = {
+                .midi_note = melody[i],
+                .duration_ms = 200,
+                .amplitude = 0.6,
+                .pan = (double)i / melody_len,
+            };
+            synth_schedule_note(synth, frame_time, (InstrumentType)(l % INST_COUNT), NOTE_CONTROL_DURATION, &cfg);
+
+            // the bass follows every 4th step
+            if (i % 4 == 0)
+            {
+                NoteCfg bass = {.midi_note = melody[i] - 24, .duration_ms = 900, .amplitude = 0.5, .pan = 0.5};
+                synth_schedule_note(synth, frame_time, INST_WARM_BASS, NOTE_CONTROL_DURATION, &bass);
+            }
+        }
+    }
+
+    clock_t start = clock();
+    uint32_t rendered = 0;
+
+    // render in chunks that do not line up with the steps
+    while (rendered < total_frames)
+    {
+        uint32_t chunk = total_frames - rendered > RENDER_CHUNK ? RENDER_CHUNK : total_frames - rendered;
+        synth_render(synth, out + rendered * 2, chunk);
+        rendered += chunk;
+    }
+
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    double audio_seconds = (double)rendered / SAMPLE_RATE;
+
+    printf("\nrendered %.2fs of audio in %.3fs cpu (%.1fx realtime)\n",
+           audio_seconds, elapsed, elapsed > 0 ? audio_seconds / elapsed : 0.0);
+
+    if (write_wav("offline_render.wav", out, rendered))
+        printf("bounced to offline_render.wav\n");
+
+    synth_print_stat(synth);
+
+    free(out);
+    synth_cleanup(synth);
+    return 0;
+}
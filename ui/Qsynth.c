@@ -40,18 +40,18 @@ static void handle_key_press(UIState *ui, int key)
             .pan = ui->pan,
         };
 
-        int voice_id = synth_play_note(ui->synth, ui->selected_instrument,
-                                       NOTE_CONTROL_MANUAL, &note_cfg);
-        ui->active_voices[key] = voice_id;
+        if (synth_play_note(ui->synth, ui->selected_instrument, NOTE_CONTROL_MANUAL, &note_cfg) >= 0)
+            ui->held_notes[key] = midi_note;
     }
 }
 
 static void handle_key_release(UIState *ui, int key)
 {
-    if (ui->active_voices[key] >= 0)
+    // remember the note, the octave may have changed while the key was held
+    if (ui->held_notes[key] >= 0)
     {
-        synth_end_note(ui->synth, ui->active_voices[key]);
-        ui->active_voices[key] = -1;
+        synth_end_note_by_key(ui->synth, 0, ui->held_notes[key]);
+        ui->held_notes[key] = -1;
     }
 }
 
@@ -97,9 +97,9 @@ int main()
         ui.pedals_info[i] = synth_pedal_info((PedalType)i);
     }
 
-    for (int i = 0; i < 256; i++)
+    for (int i = 0; i < 512; i++)
     {
-        ui.active_voices[i] = -1;
+        ui.held_notes[i] = -1;
     }
 
     // Initialize Raylib
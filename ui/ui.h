@@ -21,7 +21,7 @@ typedef struct
     float amplitude;
     int octave;
     float pan;
-    int active_voices[512];
+    int held_notes[512]; // midi note started by each keyboard key, -1 if up
 
     // Visualization
     float waveform_data[WAVEFORM_SAMPLES];